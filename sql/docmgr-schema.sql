@@ -13,6 +13,14 @@
 /* ========================================================================= */
 /*---------------------------------------------------------------------------*/
 
+
+/* Incremental auto-vacuum, so that the space freed by purging documents can */
+/* be handed back a slice at a time.  This must come before any tables are   */
+/* created.                                                                  */
+
+PRAGMA auto_vacuum = INCREMENTAL;
+
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*  TABLE DEFINITIONS                                                        */
@@ -22,16 +30,16 @@
 /* documents: Master document list.                                          */
 /*                                                                           */
 /* Each document entered in the database has an entry in this table, through */
-/* which it is assigned a unique document ID (a six-digit number padded on   */
-/* the left with zeroes).  The documents table records the document type,    */
-/* the type of the holding (whether it's a paper document, a book, something */
-/* held electronically, or whatever) and the status (whether I've read it,   */
-/* written it, etc.), and the creation date of the entry.  Document types    */
-/* are taken from the doc_types table, defined below.                        */
+/* which it is assigned a unique document ID (an integer, displayed as a     */
+/* six-digit number padded on the left with zeroes).  The documents table    */
+/* records the document type, the type of the holding (whether it's a paper  */
+/* document, a book, something held electronically, or whatever) and the     */
+/* status (whether I've read it, written it, etc.), and the creation date of */
+/* the entry.  Document types are taken from the doc_types table, defined    */
+/* below.                                                                    */
 /*                                                                           */
 /* +-------------+---------------------------------------------------------+ */
-/* | doc_id      | Document ID (six digit number, padded on left with      | */
-/* |             | zeroes.                                                 | */
+/* | id          | Document ID (integer, an alias for the table's rowid).  | */
 /* +-------------+---------------------------------------------------------+ */
 /* | doc_type    | Two character code for document type (taken from        | */
 /* |             | doc_types table.                                        | */
@@ -44,12 +52,10 @@
 /* +-------------+---------------------------------------------------------+ */
 
 CREATE TABLE documents (
-  id           CHAR(6)     NOT NULL,
+  id           INTEGER     PRIMARY KEY,
   doc_type     CHAR(2)     NOT NULL,
   holding      VARCHAR(3)  DEFAULT '-',
-  status       CHAR(1)     DEFAULT '-',
-
-  PRIMARY KEY (id)
+  status       CHAR(1)     DEFAULT '-'
 );
 
 
@@ -59,11 +65,11 @@ CREATE TABLE documents (
 /* to use.                                                                   */
 /*                                                                           */
 /* +------------+-----------------------------------------------------------+ */
-/* | next_value | Next document ID to use (six digits).                     | */
+/* | next_value | Next document ID to use.                                  | */
 /* +------------+-----------------------------------------------------------+ */
 
 CREATE TABLE doc_id (
-  next_value CHAR(6) NOT NULL
+  next_value INTEGER NOT NULL
 );
 
 
@@ -134,7 +140,7 @@ CREATE TABLE field_types (
 /* field IDs are taken from the field_types table.                           */
 /*                                                                           */
 /* +----------+------------------------------------------------------------+ */
-/* | doc_id   | Document ID (six digit number, padded on left with zeroes. | */
+/* | doc_id   | Document ID (integer).                                     | */
 /* +----------+------------------------------------------------------------+ */
 /* | field_id | ID of a field in the entry for the document.  These two-   | */
 /* |          | letter IDs come from the field_types table - the fields    | */
@@ -145,7 +151,7 @@ CREATE TABLE field_types (
 /* +----------+------------------------------------------------------------+ */
 
 CREATE TABLE doc_data (
-  doc_id    CHAR(6)       NOT NULL,
+  doc_id    INTEGER       NOT NULL,
   field_id  CHAR(2)       NOT NULL,
   data      TEXT,
 
@@ -181,14 +187,11 @@ CREATE TABLE doc_fields (
 /* yet been purged.                                                          */
 /*                                                                           */
 /* +-------------+---------------------------------------------------------+ */
-/* | doc_id      | Document ID (six digit number, padded on left with      | */
-/* |             | zeroes.                                                 | */
+/* | id          | Document ID (integer).                                  | */
 /* +-------------+---------------------------------------------------------+ */
 
 CREATE TABLE deleted_ids (
-  id           CHAR(6)     NOT NULL,
-
-  PRIMARY KEY (id)
+  id           INTEGER     PRIMARY KEY
 );
 
 
@@ -211,6 +214,76 @@ CREATE TABLE journal_abbrevs (
 );
 
 
+/* schema_version: Database schema version.                                  */
+/*                                                                           */
+/* Table with single column and single row, recording the version of this    */
+/* schema that the database follows.  The document manager library brings    */
+/* databases with older schema versions (or no schema_version table at all,  */
+/* which counts as version 0) up to date when it opens them.                 */
+/*                                                                           */
+/* +---------+-------------------------------------------------------------+ */
+/* | version | Schema version number.                                      | */
+/* +---------+-------------------------------------------------------------+ */
+
+CREATE TABLE schema_version (
+  version INTEGER NOT NULL
+);
+
+
+/* doc_text: Full-text index of document field data.                        */
+/*                                                                           */
+/* Contentless FTS5 table using the trigram tokenizer, with one row for each */
+/* row in doc_data, used for quick searches.  The rowid of each entry        */
+/* encodes the document ID and field ID of the doc_data row it indexes       */
+/* (doc_id * 65536 plus the two field ID characters).  The index is kept up  */
+/* to date by triggers on doc_data.                                          */
+
+CREATE VIRTUAL TABLE doc_text USING fts5 (data, content='', tokenize='trigram');
+
+CREATE TRIGGER doc_text_insert AFTER INSERT ON doc_data BEGIN
+  INSERT INTO doc_text (rowid, data)
+    VALUES (new.doc_id * 65536 + unicode(substr(new.field_id, 1, 1)) * 256 +
+            unicode(substr(new.field_id, 2, 1)), new.data);
+END;
+
+CREATE TRIGGER doc_text_delete AFTER DELETE ON doc_data BEGIN
+  INSERT INTO doc_text (doc_text, rowid, data)
+    VALUES ('delete', old.doc_id * 65536 +
+            unicode(substr(old.field_id, 1, 1)) * 256 +
+            unicode(substr(old.field_id, 2, 1)), old.data);
+END;
+
+CREATE TRIGGER doc_text_update AFTER UPDATE ON doc_data BEGIN
+  INSERT INTO doc_text (doc_text, rowid, data)
+    VALUES ('delete', old.doc_id * 65536 +
+            unicode(substr(old.field_id, 1, 1)) * 256 +
+            unicode(substr(old.field_id, 2, 1)), old.data);
+  INSERT INTO doc_text (rowid, data)
+    VALUES (new.doc_id * 65536 + unicode(substr(new.field_id, 1, 1)) * 256 +
+            unicode(substr(new.field_id, 2, 1)), new.data);
+END;
+
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*  INDEX DEFINITIONS                                                        */
+/*                                                                           */
+/* The document manager library checks for these indexes whenever it opens   */
+/* the database, and creates any that are missing.                           */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+/* Field value lookups (covering, so substring matches scan only the index). */
+
+CREATE INDEX doc_data_field_value ON doc_data (field_id, data, doc_id);
+
+
+/* Document status and holding lookups. */
+
+CREATE INDEX documents_status ON documents (status);
+CREATE INDEX documents_holding ON documents (holding);
+
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*  DATA INITIALISATION                                                      */
@@ -219,10 +292,16 @@ CREATE TABLE journal_abbrevs (
 
 /* Initial document ID. */
 
-INSERT INTO doc_id VALUES ('000001');
+INSERT INTO doc_id VALUES (1);
+
+
+/* Schema version. */
+
+INSERT INTO schema_version VALUES (3);
 
 
-/* Define field types. */
+/* Define field types.  These and the document types below must match        */
+/* the compile-time catalog in src/libsrc/Catalog.hh (see test-catalog).     */
 
 INSERT INTO field_types VALUES ('AD', 'address',      '~*');
 INSERT INTO field_types VALUES ('BT', 'booktitle',    '~*');
@@ -254,7 +333,7 @@ INSERT INTO field_types VALUES ('XR', 'crossref',     '=');
 INSERT INTO field_types VALUES ('TG', '',             '~*');
 
 
-/* Define document types with their associated fields. */
+/* Define document types with their associated fields.                       */
 
 INSERT INTO doc_types VALUES ('AT', 'Article', '(AND AU JN TI YR)');
 INSERT INTO doc_fields VALUES ('AT', 'AU');
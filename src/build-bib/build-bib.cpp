@@ -32,6 +32,7 @@ using namespace std;
 // Local headers.
 
 #include "DocMgr.hh"
+#include "Catalog.hh"
 
 
 //----------------------------------------------------------------------
@@ -40,8 +41,8 @@ using namespace std;
 //
 //----------------------------------------------------------------------
 
-string convert_doc_type(string docmgr);
-string convert_field_type(string docmgr);
+string convert_doc_type(DocMgr::DocType docmgr);
+string convert_field_type(DocMgr::FieldType docmgr);
 void display_record(ostream &ostr, int number, DocMgr::DocRecord *rec);
 string escape_latex_commands(string s);
 
@@ -85,64 +86,6 @@ private:
   int _number;
 };
 
-struct DocMgrToBibTeX {
-  const char *docmgr;
-  const char *bibtex;
-};
-
-
-//----------------------------------------------------------------------
-//
-//  GLOBAL VARIABLE DEFINITIONS
-//
-//----------------------------------------------------------------------
-
-DocMgrToBibTeX doc_types[] = {
-  { "AT", "Article" },
-  { "BK", "Book" },
-  { "BL", "Booklet" },
-  { "IB", "InBook" },
-  { "IC", "InCollection" },
-  { "IP", "InProceedings" },
-  { "MA", "Manual" },
-  { "MT", "MastersThesis" },
-  { "MS", "Misc" },
-  { "PH", "PhdThesis" },
-  { "PR", "Proceedings" },
-  { "TR", "TechReport" },
-  { "UP", "Unpublished" }
-};
-
-DocMgrToBibTeX field_types[] = {
-  { "AD", "address" },
-  { "BT", "booktitle" },
-  { "CA", "chapter" },
-  { "EN", "edition" },
-  { "ED", "editor" },
-  { "HO", "howpublished" },
-  { "IN", "institution" },
-  { "JN", "journal" },
-  { "MO", "month" },
-  { "NT", "note" },
-  { "NO", "number" },
-  { "OG", "organization" },
-  { "PU", "publisher" },
-  { "SH", "school" },
-  { "TI", "title" },
-  { "TY", "type" },
-  { "UR", "url" },
-  { "YR", "year" },
-  { "SE", "series" },
-  { "VO", "volume" },
-  { "AU", "author" },
-  { "LA", "language" },
-  { "IS", "isbn" },
-  { "KW", "keywords" },
-  { "EP", "eprint" },
-  { "PG", "pages" },
-  { "XR", "crossref" }
-};
-
 
 //----------------------------------------------------------------------
 //
@@ -374,7 +317,7 @@ int main(int argc, char *argv[])
     string failure_msg;
     DocMgr::Connection *conn = 0;
     try {
-      conn = new DocMgr::Connection(db);
+      conn = new DocMgr::Connection(db, false, true);
     } catch (DocMgr::Exception &exc) {
       if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
       failure_msg = exc.msg();
@@ -385,7 +328,8 @@ int main(int argc, char *argv[])
     }
 
     // Get database records.
-    map<string, DocMgr::DocRecord *> ref_recs;
+    vector<string> ref_names;
+    vector<DocMgr::DocID> ref_ids;
     for (map<string, RefDefinition>::const_iterator it = refs.begin();
          it != refs.end(); ++it) {
       const RefDefinition &rrr = it->second;
@@ -401,27 +345,48 @@ int main(int argc, char *argv[])
              << ": non-unique result for reference '"
              << it->first << "'" << endl;
         error = true;
-      } else
-        ref_recs[it->first] = conn->get_doc_by_id(ids[0]);
+      } else {
+        ref_names.push_back(it->first);
+        ref_ids.push_back(ids[0]);
+      }
     }
     if (error) {
       cout << "Errors encountered.  Exiting" << endl;
       exit(1);
     }
+    map<string, DocMgr::DocRecord *> ref_recs;
+    vector<DocMgr::DocRecord *> recs;
+    conn->get_docs_by_ids(ref_ids, recs);
+    for (int idx = 0; idx < recs.size(); ++idx)
+      ref_recs[ref_names[idx]] = recs[idx];
 
     // Get cross-reference database records.
-    map<DocMgr::DocID, DocMgr::DocRecord *> xref_recs;
+    set<DocMgr::DocID> xref_id_set;
     for (map<string, DocMgr::DocRecord *>::iterator it = ref_recs.begin();
          it != ref_recs.end(); ++it) {
       DocMgr::DocRecord *rec = it->second;
-      map<DocMgr::FieldType, string> &fields = rec->fields();
-      map<DocMgr::FieldType, string>::iterator xrf =
+      DocMgr::DocFields &fields = rec->fields();
+      DocMgr::DocFields::iterator xrf =
         fields.find(DocMgr::FieldType(*conn, "XR"));
-      if (xrf != fields.end()) {
-        DocMgr::DocID xref_id = xrf->second;
-        xref_recs[xref_id] = conn->get_doc_by_id(xref_id);
+      if (xrf == fields.end()) continue;
+      if (DocMgr::DocID::valid(xrf->second))
+        xref_id_set.insert(DocMgr::DocID(xrf->second));
+      else {
+        cout << infile << ':' << ref_lines[it->first]
+             << ": invalid cross-reference '" << xrf->second
+             << "' for reference '" << it->first << "'" << endl;
+        error = true;
       }
     }
+    if (error) {
+      cout << "Errors encountered.  Exiting" << endl;
+      exit(1);
+    }
+    vector<DocMgr::DocID> xref_ids(xref_id_set.begin(), xref_id_set.end());
+    conn->get_docs_by_ids(xref_ids, recs);
+    map<DocMgr::DocID, DocMgr::DocRecord *> xref_recs;
+    for (int idx = 0; idx < recs.size(); ++idx)
+      xref_recs[xref_ids[idx]] = recs[idx];
 
     // Rewind for second pass.
     delete istr;
@@ -539,9 +504,9 @@ int main(int argc, char *argv[])
         }
 
         bstr << '@' << entry_type << '{' << name << ',' << endl;
-        map<DocMgr::FieldType, string> &fields = rec->fields();
+        DocMgr::DocFields &fields = rec->fields();
         bool first = true;
-        for (map<DocMgr::FieldType, string>::iterator it = fields.begin();
+        for (DocMgr::DocFields::iterator it = fields.begin();
              it != fields.end(); ++it) {
           if (it->second == "") continue;
           string field_name = convert_field_type(it->first);
@@ -573,9 +538,9 @@ int main(int argc, char *argv[])
 
         string name = string("xref-") + string(id);
         bstr << '@' << entry_type << '{' << name << ',' << endl;
-        map<DocMgr::FieldType, string> &fields = rec->fields();
+        DocMgr::DocFields &fields = rec->fields();
         bool first = true;
-        for (map<DocMgr::FieldType, string>::iterator it = fields.begin();
+        for (DocMgr::DocFields::iterator it = fields.begin();
              it != fields.end(); ++it) {
           if (it->second == "") continue;
           string field_name = convert_field_type(it->first);
@@ -697,22 +662,19 @@ int main(int argc, char *argv[])
 //
 //----------------------------------------------------------------------
 
-string convert_doc_type(string docmgr)
+// BibTeX names come straight from the compile-time catalog, without
+// any lookup: types that aren't in the catalog have no BibTeX name.
+
+string convert_doc_type(DocMgr::DocType docmgr)
 {
-  for (int idx = 0;
-       idx < sizeof(doc_types) / sizeof(DocMgrToBibTeX); ++idx)
-    if (docmgr == doc_types[idx].docmgr)
-      return doc_types[idx].bibtex;
-  return "";
+  int idx = docmgr.catalog();
+  return idx < 0 ? "" : DocMgr::Catalog::doc_types[idx].name;
 }
 
-string convert_field_type(string docmgr)
+string convert_field_type(DocMgr::FieldType docmgr)
 {
-  for (int idx = 0;
-       idx < sizeof(field_types) / sizeof(DocMgrToBibTeX); ++idx)
-    if (docmgr == field_types[idx].docmgr)
-      return field_types[idx].bibtex;
-  return "";
+  int idx = docmgr.catalog();
+  return idx < 0 ? "" : DocMgr::Catalog::field_types[idx].name;
 }
 
 string escape_latex_commands(string s)
@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   docmgr-backup.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//----------------------------------------------------------------------
+//
+//  Online database backup: writes a compressed copy of the database
+//  to docmgr-backup-<date>.db.gz, which gunzip turns back into a
+//  database file.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// System headers.
+
+#include <unistd.h>
+
+
+// Library headers.
+
+#include <zlib.h>
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+bool compress_file(string src, string dest);
+
+
+//----------------------------------------------------------------------
+//
+//  MAIN PROGRAM
+//
+//----------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  try {
+    if (argc > 2) {
+      cout << "Usage: docmgr-backup [<directory>]" << endl;
+      exit(1);
+    }
+    string dir = argc == 2 ? string(argv[1]) + "/" : "";
+
+    // Connect to database.
+    string db;
+    if (getenv("DOCMGR_DB"))
+      db = getenv("DOCMGR_DB");
+    else {
+      string home = getenv("HOME");
+      db = home + "/.docmgr2/docmgr.db";
+    }
+
+    char date[16];
+    time_t now = time(0);
+    strftime(date, sizeof(date), "%Y-%m-%d", localtime(&now));
+    string fname = dir + "docmgr-backup-" + date + ".db";
+
+    // The SQLite backup API can only write to a database file, so the
+    // database is copied to a temporary file (in $TMPDIR rather than
+    // next to the backup), which is then compressed a block at a time.
+    // The copy is made without opening a full connection, so that the
+    // database isn't migrated or otherwise changed before it's backed
+    // up.
+    string tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    char suffix[32];
+    sprintf(suffix, "/docmgr-backup-%d.db", int(getpid()));
+    string tmpname = tmpdir + suffix;
+    try {
+      DocMgr::Connection::backup(db, tmpname);
+    } catch (DocMgr::Exception &exc) {
+      if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
+      remove(tmpname.c_str());
+      cout << "Database error: " << exc.msg() << endl;
+      exit(1);
+    }
+    bool ok = compress_file(tmpname, fname + ".gz");
+    remove(tmpname.c_str());
+    if (!ok) {
+      remove((fname + ".gz").c_str());
+      cout << "Failed to write " << fname << ".gz" << endl;
+      exit(1);
+    }
+
+    cout << "Backup is " << fname << ".gz" << endl;
+  } catch (DocMgr::Exception &exc) {
+    cout << "UNCAUGHT DocMgr EXCEPTION: " << exc.msg() << endl;
+    exit(1);
+  }
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+bool compress_file(string src, string dest)
+{
+  FILE *in = fopen(src.c_str(), "rb");
+  if (!in) return false;
+  gzFile out = gzopen(dest.c_str(), "wb");
+  if (!out) {
+    fclose(in);
+    return false;
+  }
+
+  vector<char> buff(262144);
+  bool ok = true;
+  size_t len;
+  while (ok && (len = fread(&buff[0], 1, buff.size(), in)) > 0)
+    ok = gzwrite(out, &buff[0], len) == len;
+  if (ferror(in)) ok = false;
+  fclose(in);
+  if (gzclose(out) != Z_OK) ok = false;
+  return ok;
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
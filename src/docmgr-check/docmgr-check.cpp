@@ -0,0 +1,136 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   docmgr-check.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//----------------------------------------------------------------------
+//
+//  Database consistency checker.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+string describe(const DocMgr::Violation &v);
+
+
+//----------------------------------------------------------------------
+//
+//  MAIN PROGRAM
+//
+//----------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  try {
+    if (argc > 2) {
+      cout << "Usage: docmgr-check [<database>]" << endl;
+      exit(1);
+    }
+
+    // Connect to database.
+    string db;
+    if (argc == 2)
+      db = argv[1];
+    else if (getenv("DOCMGR_DB"))
+      db = getenv("DOCMGR_DB");
+    else {
+      string home = getenv("HOME");
+      db = home + "/.docmgr2/docmgr.db";
+    }
+    string failure_msg;
+    DocMgr::Connection *conn = 0;
+    vector<DocMgr::Violation> violations;
+    try {
+      conn = new DocMgr::Connection(db);
+      conn->validate(violations);
+    } catch (DocMgr::Exception &exc) {
+      if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
+      failure_msg = exc.msg();
+    }
+    if (failure_msg != "") {
+      cout << "Database error: " << failure_msg << endl;
+      exit(1);
+    }
+
+    for (int idx = 0; idx < violations.size(); ++idx)
+      cout << describe(violations[idx]) << endl;
+    if (violations.size() > 0)
+      cout << violations.size() << " problem(s) found" << endl;
+    delete conn;
+    exit(violations.size() > 0 ? 1 : 0);
+  } catch (DocMgr::Exception &exc) {
+    cout << "UNCAUGHT DocMgr EXCEPTION: " << exc.msg() << endl;
+    exit(1);
+  }
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// Document IDs are shown as they are in the user interface, unless
+// they're out of range, which can happen for orphaned field data.
+
+string describe(const DocMgr::Violation &v)
+{
+  string id;
+  if (DocMgr::DocID::valid(v.doc_id))
+    id = string(DocMgr::DocID(v.doc_id));
+  else {
+    char buff[16];
+    sprintf(buff, "%d", v.doc_id);
+    id = buff;
+  }
+
+  switch (v.kind) {
+  case DocMgr::Violation::MISSING_FIELDS:
+    return id + ": missing mandatory field(s): " + v.detail;
+  case DocMgr::Violation::UNKNOWN_DOCTYPE:
+    return id + ": unknown document type: " + v.detail;
+  case DocMgr::Violation::UNKNOWN_FIELD:
+    return id + ": unknown field type: " + v.detail;
+  case DocMgr::Violation::UNEXPECTED_FIELD:
+    return id + ": field not used by document type: " + v.detail;
+  case DocMgr::Violation::DANGLING_XREF:
+    return id + ": cross-reference to missing document: " + v.detail;
+  case DocMgr::Violation::ORPHANED_DATA:
+    return id + ": field data for missing document: " + v.detail;
+  }
+  return id + ": " + v.detail;
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,348 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   docmgr-load.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//----------------------------------------------------------------------
+//
+//  Bulk loader for SQL insert scripts (e.g. sql/abbrevs.dat) and
+//  table dumps written by the old PostgreSQL docmgr-backup script.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+
+// Library headers.
+
+#include <zlib.h>
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+
+
+//----------------------------------------------------------------------
+//
+//  CLASS DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// Input file, which may be compressed, read a line at a time.  Lines
+// are returned without their line ending, in a buffer owned by the
+// reader that's valid until the next call.
+
+class LineReader {
+public:
+
+  LineReader(string fname);
+  ~LineReader() { if (_file) gzclose(_file); }
+
+  bool ok(void) const { return _file != 0; }
+  char *next(void);
+  int line(void) const { return _line; }
+
+private:
+
+  gzFile _file;
+  vector<char> _buff;
+  int _line;
+};
+
+
+// Parse error, with the position of the offending line.
+
+struct ParseError {
+  ParseError(string msg) : msg(msg) { }
+  string msg;
+};
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+void load_file(DocMgr::BulkLoader &loader, string fname,
+               map<string, int> &counts);
+string parse_insert(char *line, vector<const char *> &values);
+void parse_copy(char *line, vector<const char *> &values);
+
+
+//----------------------------------------------------------------------
+//
+//  MAIN PROGRAM
+//
+//----------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  try {
+    if (argc < 2) {
+      cout << "Usage: docmgr-load <file>..." << endl;
+      exit(1);
+    }
+
+    // Connect to database.
+    string db;
+    if (getenv("DOCMGR_DB"))
+      db = getenv("DOCMGR_DB");
+    else {
+      string home = getenv("HOME");
+      db = home + "/.docmgr2/docmgr.db";
+    }
+
+    // Everything is loaded in one transaction, so an error anywhere
+    // leaves the database as it was.
+    string failure_msg;
+    map<string, int> counts;
+    try {
+      DocMgr::Connection conn(db);
+      DocMgr::BulkLoader loader(conn);
+      for (int arg = 1; arg < argc; ++arg)
+        load_file(loader, argv[arg], counts);
+      loader.commit();
+    } catch (DocMgr::Exception &exc) {
+      if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
+      failure_msg = "Database error: " + exc.msg();
+    } catch (ParseError &err) {
+      failure_msg = err.msg;
+    }
+    if (failure_msg != "") {
+      cout << failure_msg << endl;
+      exit(1);
+    }
+
+    for (map<string, int>::iterator it = counts.begin();
+         it != counts.end(); ++it)
+      cout << it->first << ": " << it->second << " row(s)" << endl;
+  } catch (DocMgr::Exception &exc) {
+    cout << "UNCAUGHT DocMgr EXCEPTION: " << exc.msg() << endl;
+    exit(1);
+  }
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: LineReader
+//
+//----------------------------------------------------------------------
+
+// A file name of "-" reads standard input.  zlib reads uncompressed
+// files as they are.
+
+LineReader::LineReader(string fname) : _buff(65536), _line(0)
+{
+  _file = fname == "-" ? gzdopen(0, "rb") : gzopen(fname.c_str(), "rb");
+  if (_file) gzbuffer(_file, 262144);
+}
+
+
+char *LineReader::next(void)
+{
+  int len = 0;
+  while (true) {
+    if (!gzgets(_file, &_buff[len], _buff.size() - len)) {
+      if (len == 0) return 0;
+      break;
+    }
+    len += strlen(&_buff[len]);
+    if (len > 0 && _buff[len - 1] == '\n') break;
+    if (len == _buff.size() - 1) _buff.resize(_buff.size() * 2);
+  }
+  ++_line;
+  while (len > 0 && (_buff[len - 1] == '\n' || _buff[len - 1] == '\r'))
+    _buff[--len] = '\0';
+  return &_buff[0];
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// A file can mix INSERT statements, one to a line, with backup
+// sections, each of which starts with a "---- <table> ----" line and
+// runs up to a blank line.  Each backup section replaces the contents
+// of its table.  Blank lines and SQL comments are skipped.
+
+void load_file(DocMgr::BulkLoader &loader, string fname,
+               map<string, int> &counts)
+{
+  LineReader in(fname);
+  if (!in.ok()) throw ParseError("Can't open input file '" + fname + "'");
+
+  string table = "";
+  bool copying = false;
+  vector<const char *> values;
+  char *line;
+  try {
+    while ((line = in.next())) {
+      if (copying) {
+        if (line[0] == '\0' || strcmp(line, "\\.") == 0) {
+          copying = false;
+          continue;
+        }
+        parse_copy(line, values);
+      } else if (strncmp(line, "---- ", 5) == 0) {
+        char *end = strstr(line + 5, " ----");
+        if (!end) throw ParseError("Bad section header");
+        table = string(line + 5, end - line - 5);
+        loader.table(table, true);
+        counts[table];
+        copying = true;
+        continue;
+      } else if (line[0] == '\0' || strncmp(line, "--", 2) == 0)
+        continue;
+      else {
+        string insert_table = parse_insert(line, values);
+        if (insert_table != table) {
+          table = insert_table;
+          loader.table(table, false);
+        }
+      }
+      loader.add(values);
+      ++counts[table];
+    }
+  } catch (ParseError &err) {
+    char buff[32];
+    sprintf(buff, ":%d: ", in.line());
+    throw ParseError(fname + buff + err.msg);
+  }
+}
+
+
+// INSERT INTO <table> VALUES (<value>, ...);  Values are quoted
+// strings (with doubled quotes), NULL or bare numbers.  Strings are
+// unquoted in place.
+
+string parse_insert(char *line, vector<const char *> &values)
+{
+  static const char prefix[] = "INSERT INTO ";
+  if (strncmp(line, prefix, sizeof(prefix) - 1) != 0)
+    throw ParseError("Expected INSERT statement or backup section");
+  char *pos = line + sizeof(prefix) - 1;
+  char *name = pos;
+  while (*pos && *pos != ' ' && *pos != '(') ++pos;
+  string table(name, pos - name);
+  while (*pos == ' ') ++pos;
+  if (strncmp(pos, "VALUES", 6) != 0)
+    throw ParseError("Expected VALUES");
+  pos += 6;
+  while (*pos == ' ') ++pos;
+  if (*pos++ != '(') throw ParseError("Expected '('");
+
+  values.clear();
+  while (true) {
+    while (*pos == ' ') ++pos;
+    if (*pos == '\'') {
+      char *val = ++pos, *out = pos;
+      while (true) {
+        if (!*pos) throw ParseError("Unterminated string");
+        if (*pos == '\'') {
+          if (pos[1] != '\'') break;
+          ++pos;
+        }
+        *out++ = *pos++;
+      }
+      ++pos;
+      *out = '\0';
+      values.push_back(val);
+    } else {
+      char *val = pos;
+      while (*pos && *pos != ',' && *pos != ')' && *pos != ' ') ++pos;
+      if (pos == val) throw ParseError("Missing value");
+      char term = *pos;
+      *pos = '\0';
+      values.push_back(strcmp(val, "NULL") == 0 ? 0 : val);
+      *pos = term;
+      if (term == ' ') *pos++ = '\0';
+    }
+    while (*pos == ' ') ++pos;
+    char sep = *pos;
+    *pos++ = '\0';
+    if (sep == ')') break;
+    if (sep != ',') throw ParseError("Expected ',' or ')'");
+  }
+  while (*pos == ' ') ++pos;
+  if (*pos != ';') throw ParseError("Expected ';'");
+  return table;
+}
+
+
+// COPY text format: tab-separated columns, with "\N" for NULL and
+// backslash escapes for special characters.  Columns are unescaped in
+// place.
+
+void parse_copy(char *line, vector<const char *> &values)
+{
+  values.clear();
+  char *pos = line;
+  while (true) {
+    char *val = pos, *out = pos;
+    if (pos[0] == '\\' && pos[1] == 'N' && (pos[2] == '\t' || !pos[2])) {
+      values.push_back(0);
+      pos += 2;
+    } else {
+      while (*pos && *pos != '\t') {
+        if (*pos != '\\') {
+          *out++ = *pos++;
+          continue;
+        }
+        char ch = *++pos;
+        if (!ch) throw ParseError("Bad escape sequence");
+        ++pos;
+        switch (ch) {
+        case 'b': *out++ = '\b';  break;
+        case 'f': *out++ = '\f';  break;
+        case 'n': *out++ = '\n';  break;
+        case 'r': *out++ = '\r';  break;
+        case 't': *out++ = '\t';  break;
+        case 'v': *out++ = '\v';  break;
+        default:
+          if (ch >= '0' && ch <= '7') {
+            int code = ch - '0';
+            for (int digit = 0; digit < 2 && *pos >= '0' && *pos <= '7';
+                 ++digit)
+              code = code * 8 + *pos++ - '0';
+            *out++ = code;
+          } else
+            *out++ = ch;
+        }
+      }
+      values.push_back(val);
+    }
+    char sep = *pos;
+    *out = '\0';
+    if (!sep) break;
+    if (out != pos) *pos = '\0';
+    ++pos;
+  }
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -68,10 +68,10 @@ DocMgr::DocID ArticleEditForm::run(void)
   action_menu.add_item("&Revert", CANCEL_ACTION);
   action_menu.display();
 
-  map<DocMgr::FieldType, string> &fields = _doc->fields();
+  DocMgr::DocFields &fields = _doc->fields();
   int row = 0;
-  for (int fld = 0; _field_order[fld].id[0]; ++fld) {
-    map<DocMgr::FieldType, string>::iterator it =
+  for (int fld = 0; fld < NFIELDS; ++fld) {
+    DocMgr::DocFields::iterator it =
       fields.find(DocMgr::FieldType(*_db, _field_order[fld].id));
     if (it == fields.end()) continue;
     string field_type = it->first;
@@ -155,9 +155,9 @@ DocMgr::DocID ArticleEditForm::run(void)
       if (*_curr_field == before_field && before_height != after_height) {
         int dy = after_height - before_height;
         bool found = false;
-        map<DocMgr::FieldType, string> &fields = _doc->fields();
-        for (int fld = 0; _field_order[fld].id[0]; ++fld) {
-          map<DocMgr::FieldType, string>::const_iterator it =
+        DocMgr::DocFields &fields = _doc->fields();
+        for (int fld = 0; fld < NFIELDS; ++fld) {
+          DocMgr::DocFields::const_iterator it =
             fields.find(DocMgr::FieldType(*_db, _field_order[fld].id));
           if (it == fields.end()) continue;
           EditField *field =
@@ -276,11 +276,11 @@ void ArticleEditForm::display(void)
   if (!_doc) return;
 
   string header_blanking(_header_width, ' ');
-  map<DocMgr::FieldType, string> &fields = _doc->fields();
+  DocMgr::DocFields &fields = _doc->fields();
   int row = 0, curr_field_row;
-  for (int fld = 0; _field_order[fld].id[0]; ++fld) {
+  for (int fld = 0; fld < NFIELDS; ++fld) {
     string id = _field_order[fld].id;
-    map<DocMgr::FieldType, string>::const_iterator it =
+    DocMgr::DocFields::const_iterator it =
       fields.find(DocMgr::FieldType(*_db, _field_order[fld].id));
     bool multiline =
       _multiline_fields[DocMgr::FieldType(*_db, _field_order[fld].id)];
@@ -296,7 +296,7 @@ void ArticleEditForm::display(void)
       row += field->lines();
     else {
       writestr(2, row + 3, header_blanking);
-      writestr(2, row + 3, string(_field_order[fld].name) + ":");
+      writestr(2, row + 3, string(_field_order[fld].label) + ":");
       if (field != *_curr_field) {
         if (row + field->lines() - 1 >= _h - 4)
           field->display(_h - 4 - row);
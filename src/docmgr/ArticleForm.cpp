@@ -32,46 +32,8 @@
 //
 //----------------------------------------------------------------------
 
-const ArticleForm::FieldDesc ArticleForm::_field_order[] = {
-  { "AU", "Author" },
-  { "TI", "Title" },
-
-  { "YR", "Year" },
-  { "MO", "Month" },
-
-  { "JN", "Journal" },
-  { "VO", "Volume" },
-  { "NO", "Number" },
-  { "PG", "Pages" },
-
-  { "BT", "Book Title" },
-  { "ED", "Editor" },
-  { "EN", "Edition" },
-  { "CA", "Chapter" },
-  { "SE", "Series" },
-
-  { "PU", "Publisher" },
-  { "OG", "Organization" },
-  { "IN", "Institution" },
-  { "SH", "School" },
-  { "AD", "Address" },
-
-  { "HO", "How Published" },
-  { "LA", "Language" },
-  { "TY", "Type" },
-
-  { "IS", "ISBN" },
-  { "EP", "E-print" },
-  { "UR", "URL" },
-
-  { "KW", "Keywords" },
-  { "NT", "Note" },
-  { "TG", "Tags" },
-
-  { "XR", "Cross Ref." },
-
-  { "", "" }
-};
+const DocMgr::Catalog::FieldTypeDef *const ArticleForm::_field_order =
+  DocMgr::Catalog::field_types;
 
 
 //----------------------------------------------------------------------
@@ -119,12 +81,12 @@ int ArticleForm::field_header_width(bool present_only)
   if (!_doc)
     throw DocMgr::Exception(DocMgr::Exception::MISC,
                             "ArticleForm::field_header_width");
-  map<DocMgr::FieldType, string> &fields = _doc->fields();
+  DocMgr::DocFields &fields = _doc->fields();
   int retval = 0;
-  for (map<DocMgr::FieldType, string>::const_iterator it = fields.begin();
+  for (DocMgr::DocFields::const_iterator it = fields.begin();
        it != fields.end(); ++it) {
     int order = field_order(it->first);
-    string header = _field_order[order].name;
+    string header = _field_order[order].label;
     if (header.size() > retval)
       if (!present_only || it->second.size() > 0)
         retval = header.size();
@@ -135,23 +97,17 @@ int ArticleForm::field_header_width(bool present_only)
 
 int ArticleForm::field_order(DocMgr::FieldType type)
 {
-  string type_str = string(type);
-  for (int idx = 0; _field_order[idx].id[0]; ++idx)
-    if (_field_order[idx].id == type_str)
-      return idx;
-  throw DocMgr::Exception(DocMgr::Exception::MISC,
-                          "ArticleForm::field_order");
+  int retval = type.catalog();
+  if (retval < 0)
+    throw DocMgr::Exception(DocMgr::Exception::MISC,
+                            "ArticleForm::field_order");
+  return retval;
 }
 
 
 string ArticleForm::field_name(DocMgr::FieldType type)
 {
-  string type_str = string(type);
-  for (int idx = 0; _field_order[idx].id[0]; ++idx)
-    if (_field_order[idx].id == type_str)
-      return _field_order[idx].name;
-  throw DocMgr::Exception(DocMgr::Exception::MISC,
-                          "ArticleForm::field_name");
+  return _field_order[field_order(type)].label;
 }
 
 
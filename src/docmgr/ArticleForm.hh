@@ -34,6 +34,7 @@ using namespace std;
 // Local headers.
 
 #include "DocMgr.hh"
+#include "Catalog.hh"
 #include "Widget.hh"
 
 
@@ -46,12 +47,6 @@ using namespace std;
 class ArticleForm : public Widget {
 public:
 
-  struct FieldDesc {
-    const char *id;
-    const char *name;
-  };
-
-
   // An article form is fixed in position, and permanently associated
   // with a database connection.
 
@@ -66,7 +61,9 @@ protected:
 
   int field_header_width(bool present_only);
 
-  static const FieldDesc _field_order[];
+  // Fields are shown in the order they're listed in the catalog.
+  static const DocMgr::Catalog::FieldTypeDef *const _field_order;
+  static const int NFIELDS = DocMgr::Catalog::NFIELD_TYPES;
   static int field_order(DocMgr::FieldType type);
   static string field_name(DocMgr::FieldType type);
 
@@ -43,10 +43,10 @@ void ArticleViewForm::display(void)
   int contents_space = _w - header_width - 4;
   int min_break_pos = contents_space * 3 / 4;
   bool displaying_xref = false;
-  map<DocMgr::FieldType, string> *fields = &(_doc->fields());
+  DocMgr::DocFields *fields = &(_doc->fields());
   int row = 0;
-  for (int fld = 0; _field_order[fld].id[0]; ++fld) {
-    map<DocMgr::FieldType, string>::const_iterator it =
+  for (int fld = 0; fld < NFIELDS; ++fld) {
+    DocMgr::DocFields::const_iterator it =
       fields->find(DocMgr::FieldType(*_db, _field_order[fld].id));
     if (it == fields->end() || it->second == "") continue;
     if (string(it->first) == "XR") {
@@ -75,7 +75,7 @@ void ArticleViewForm::display(void)
       }
     }
     if (row_ok(row))
-      writestr(2, row + 3, string(_field_order[fld].name) + ":");
+      writestr(2, row + 3, string(_field_order[fld].label) + ":");
     string contents = it->second;
     if (string(it->first) == "XR") {
       // If a cross reference gets to this point, it's missing.
@@ -132,8 +132,8 @@ void ArticleViewForm::set_current(DocMgr::DocID id)
     _doc = 0;
   else {
     _doc = _db->get_doc_by_id(id);
-    map<DocMgr::FieldType, string> &fields = _doc->fields();
-    map<DocMgr::FieldType, string>::iterator it =
+    DocMgr::DocFields &fields = _doc->fields();
+    DocMgr::DocFields::iterator it =
       fields.find(DocMgr::FieldType(*_db, "XR"));
     if (it == fields.end() || !DocMgr::DocID::valid(it->second))
       _xref_doc = 0;
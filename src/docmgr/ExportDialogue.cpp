@@ -95,7 +95,7 @@ string ExportDialogue::format_current_doc(DocMgr::DocRecord *doc)
   DocMgr::FieldType au(_db, "AU"), yr(_db, "YR"), ti(_db, "TI");
   DocMgr::FieldType jn(_db, "JN"), vo(_db, "VO"), no(_db, "NO"), pg(_db, "PG");
 
-  map<DocMgr::FieldType, string> flds = doc->fields();
+  DocMgr::DocFields flds = doc->fields();
   if (flds[au] != "") {
     retval += format_author(flds[au]);
     if (flds[yr] != "") retval += string(" (") + flds[yr] + ")";
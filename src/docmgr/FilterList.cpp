@@ -74,13 +74,10 @@ FilterList::~FilterList()
 
 void FilterList::refresh(void)
 {
-  _article_counts.clear();
-  for (int idx = 0; idx < _filters.size(); ++idx) {
-    DocMgr::Query q = _filters[idx]->query();
-    vector<DocMgr::DocID> ids;
-    q.run(ids);
-    _article_counts.push_back(ids.size());
-  }
+  vector<DocMgr::Query> queries;
+  for (int idx = 0; idx < _filters.size(); ++idx)
+    queries.push_back(_filters[idx]->query());
+  _db.count_queries(queries, _article_counts);
 }
 
 
@@ -351,9 +348,7 @@ void FilterList::add_filter(void)
     else
       _filters[_current_filter_idx]->clear_status();
     DocMgr::Query q = _filters[_current_filter_idx]->query();
-    vector<DocMgr::DocID> ids;
-    q.run(ids);
-    _article_counts[_current_filter_idx] = ids.size();
+    _article_counts[_current_filter_idx] = q.count();
     _config->add_filter(_filters[_current_filter_idx]->name(),
                         _filters[_current_filter_idx]->definition(),
                         _filters[_current_filter_idx]->has_holding() ?
@@ -387,9 +382,7 @@ void FilterList::edit_current(void)
     else
       _filters[_current_filter_idx]->clear_status();
     DocMgr::Query q = _filters[_current_filter_idx]->query();
-    vector<DocMgr::DocID> ids;
-    q.run(ids);
-    _article_counts[_current_filter_idx] = ids.size();
+    _article_counts[_current_filter_idx] = q.count();
     _config->set_filter_name
       (_current_filter_idx, _filters[_current_filter_idx]->name());
     _config->set_filter_definition
@@ -462,9 +455,7 @@ void FilterList::combine_filters(void)
     else
       _filters[_current_filter_idx]->clear_status();
     DocMgr::Query q = _filters[_current_filter_idx]->query();
-    vector<DocMgr::DocID> ids;
-    q.run(ids);
-    _article_counts[_current_filter_idx] = ids.size();
+    _article_counts[_current_filter_idx] = q.count();
     _config->add_filter(_filters[_current_filter_idx]->name(),
                         _filters[_current_filter_idx]->definition(),
                         _filters[_current_filter_idx]->holding(),
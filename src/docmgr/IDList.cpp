@@ -39,7 +39,6 @@ IDList::IDList(DocMgr::Connection *db, ArticleViewForm &view_form,
 {
   _id_query = new DocMgr::Query(*db);
   fill_id_list();
-  _db->get_deleted_ids(_deleted_ids);
   _view_form.set_current(current());
 }
 
@@ -70,7 +69,6 @@ void IDList::fill_id_list(void)
   if (_ids.size() == 0)
     _top_vis = _curr_loc = -1;
   else if (_top_vis == -1) _top_vis = _curr_loc = 0;
-  _db->get_deleted_ids(_deleted_ids);
 }
 
 void IDList::refresh(void)
@@ -255,9 +253,7 @@ void IDList::set_query(DocMgr::Query &query)
 
 bool IDList::id_deleted(DocMgr::DocID id)
 {
-  for (int idx = 0; idx < _deleted_ids.size(); ++idx)
-    if (id == _deleted_ids[idx]) return true;
-  return false;
+  return _db->doc_deleted(id);
 }
 
 
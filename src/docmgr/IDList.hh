@@ -99,7 +99,6 @@ private:
   DocMgr::Query *_id_query;
   ArticleViewForm &_view_form;
   vector<DocMgr::DocID> _ids;
-  vector<DocMgr::DocID> _deleted_ids;
   int _top_vis;
   int _curr_loc;
 };
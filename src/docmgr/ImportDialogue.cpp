@@ -141,11 +141,8 @@ void ImportDialogue::run(string default_import_file)
       refresh();
       doupdate();
       InteractorList::get_char();
-    } else {
-      for (vector<DocMgr::DocRecord *>::iterator it = importer.docs().begin();
-           it != importer.docs().end(); ++it)
-        (*it)->intern();
-    }
+    } else
+      _db.intern_docs(importer.docs());
   }
 
   delete _field;
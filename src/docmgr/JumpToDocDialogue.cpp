@@ -112,12 +112,7 @@ bool JumpToDocDialogue::run(DocMgr::Connection &db, IDList *id_list)
         DocMgr::DocID id(_id_str);
         if (!id_list->id_visible(id)) {
           DocMgr::Query tmp_q(db);
-          vector<DocMgr::DocID> ids;
-          tmp_q.run(ids);
-          bool found = false;
-          for (int idx = 0; idx < ids.size(); ++idx)
-            if (ids[idx] == id) { found = true;  break; }
-          if (!found) {
+          if (!tmp_q.contains(id)) {
             ok = false;
             err_msg = "DOCUMENT ID NOT FOUND IN DATABASE!";
           } else {
@@ -31,6 +31,11 @@
 
 const int DIALOGUE_WIDTH = 50;
 
+// Interval (in tenths of a second) at which to check on a search
+// running in the background while waiting for keystrokes.
+
+const int SEARCH_POLL_INTERVAL = 1;
+
 
 //----------------------------------------------------------------------
 //
@@ -72,7 +77,15 @@ bool QuickSearchDialogue::process_key(int ch)
 }
 
 
-void QuickSearchDialogue::run(string &result)
+// While the search string is being edited, a search for the current
+// string runs in the background and the number of matches is shown
+// when it finishes.  Each change to the string cancels the previous
+// search, so typing never has to wait for a slow search to finish.
+// The results of the final search are left in the connection's query
+// cache, ready for when the search is applied.
+
+void QuickSearchDialogue::run(string &result, DocMgr::Connection &db,
+                              DocMgr::Query scope)
 {
   clear();
   frame();
@@ -92,8 +105,44 @@ void QuickSearchDialogue::run(string &result)
   interaction.push_back(*_field);
   interaction.push_back(*this);
 
+  string searched = "";
+  DocMgr::QueryJob *job = 0;
   _completed = false;
-  while (!_completed) { interaction.process_key(); doupdate(); }
+  while (!_completed) {
+    halfdelay(SEARCH_POLL_INTERVAL);
+    try {
+      interaction.process_key();
+    } catch (...) {
+      // A resize (or anything else) ends the dialogue: the search
+      // mustn't be left running, or the terminal in half-delay mode.
+      delete job;
+      cbreak();
+      throw;
+    }
+    if (_search_str != searched) {
+      delete job;
+      job = 0;
+      searched = _search_str;
+      show_matches("");
+      if (searched != "")
+        job = (scope && DocMgr::Query(db, searched)).run_async();
+    }
+    if (job && job->done()) {
+      try {
+        char buff[32];
+        sprintf(buff, "%d matches",
+                static_cast<int>(job->results().size()));
+        show_matches(buff);
+      } catch (DocMgr::Exception &exc) {
+        show_matches("search failed");
+      }
+      delete job;
+      job = 0;
+    }
+    doupdate();
+  }
+  delete job;
+  cbreak();
 
   result = _search_str;
   if (_search_str != "") {
@@ -109,6 +158,15 @@ void QuickSearchDialogue::run(string &result)
 }
 
 
+void QuickSearchDialogue::show_matches(string msg)
+{
+  frame();
+  writestr(2, 0, "Quick-Search");
+  if (msg != "") writestr(_w - msg.size() - 4, _h - 1, " " + msg + " ");
+  _field->display();
+}
+
+
 void QuickSearchDialogue::up_stack(void)
 {
   if (_sp > 0) {
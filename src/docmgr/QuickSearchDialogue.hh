@@ -29,6 +29,7 @@ using namespace std;
 
 // Local headers.
 
+#include "DocMgr.hh"
 #include "Widget.hh"
 #include "TextField.hh"
 
@@ -46,12 +47,13 @@ public:
   virtual ~QuickSearchDialogue() { }
 
   virtual bool process_key(int ch);
-  void run(string &result);
+  void run(string &result, DocMgr::Connection &db, DocMgr::Query scope);
 
 private:
 
   void up_stack(void);
   void down_stack(void);
+  void show_matches(string msg);
 
   bool _completed;
 
@@ -79,6 +79,12 @@ const int COMBINE_ACTION  = 13;
 const int JUMP_ACTION     = 14;
 const int EXPORT_ACTION   = 15;
 
+// Time (in tenths of a second) without a keystroke after which the
+// main screen hands another slice of free space back to the file
+// system, when there's any to hand back.
+
+const int VACUUM_IDLE_DELAY = 5;
+
 
 //----------------------------------------------------------------------
 //
@@ -139,7 +145,7 @@ int main(void)
       string failure_msg;
       Connection *conn = 0;
       try {
-        conn = new Connection("~/.docmgr2/docmgr.db");
+        conn = new Connection("~/.docmgr2/docmgr.db", false, true);
       } catch (DocMgr::Exception &exc) {
         if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
         failure_msg = exc.msg();
@@ -352,6 +358,32 @@ static bool run_db_good_screen(DocMgr::Connection *conn)
       bool db_changed = false;
       for (;;) {
         doupdate();
+        if (conn->vacuum_pending()) {
+          halfdelay(VACUUM_IDLE_DELAY);
+          int ch = getch();
+          cbreak();
+          if (ch == ERR) {
+            // A failed step stops the vacuum, but not the session.
+            try {
+              conn->vacuum_step();
+            } catch (DocMgr::Exception &exc) {
+              bool carry_on = ConfirmDialogue(false).run
+                ("BBACKGROUND VACUUM FAILED\n"
+                 "N" + exc.msg() + "\n"
+                 "NCarry on without it?");
+              id_list->display();
+              view_form.display();
+              default_menu.display();
+              top_line.display();
+              if (!carry_on) {
+                retval = false;
+                break;
+              }
+            }
+            continue;
+          }
+          ungetch(ch);
+        }
         responders.process_key();
 
         if (default_menu.activated()) {
@@ -441,7 +473,9 @@ static bool run_db_good_screen(DocMgr::Connection *conn)
             // Run quick search dialogue and search on the basis of
             // the result.  If the result is an empty string, unfilter
             // the results.
-            quick_search.run(search_string);
+            quick_search.run(search_string, *conn,
+                             filter != 0 ? filter->query() :
+                             DocMgr::Query(*conn));
             if (search_string.size() > 0) {
               if (filter != 0) {
                 DocMgr::Query search_query =
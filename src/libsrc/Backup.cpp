@@ -0,0 +1,137 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   Backup.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Online database backup for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+
+// Library headers.
+
+#include <sqlite3.h>
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+static void backup_from(ReaderPool *readers, string dest_file);
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: Connection
+//
+//----------------------------------------------------------------------
+
+void Connection::backup(string dest_file)
+{
+  backup_from(_priv->readers, dest_file);
+}
+
+
+// Backing up by file name only opens a read-only connection, so that
+// (unlike opening a Connection) nothing about the database is changed
+// first, and a missing database isn't created.
+
+void Connection::backup(string dbfile, string dest_file)
+{
+  if (dbfile[0] == '~') {
+    string home = getenv("HOME");
+    dbfile = home + dbfile.substr(1);
+  }
+  ReaderPool readers(dbfile, 1);
+  backup_from(&readers, dest_file);
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// The copy is made from one of the read-only connections, inside a
+// read transaction that's held until the copy is complete.  In WAL
+// mode that doesn't block writers, and as the source never sees their
+// changes, the backup doesn't restart when the database is written.
+
+static void backup_from(ReaderPool *readers, string dest_file)
+{
+  sqlite3 *dest;
+  if (sqlite3_open(dest_file.c_str(), &dest) != SQLITE_OK) {
+    string msg = sqlite3_errmsg(dest);
+    sqlite3_close(dest);
+    throw Exception(Exception::DB_ERROR,
+                    "Failed to open backup file: " + msg);
+  }
+
+  ConnectionPriv *reader = 0;
+  string error = "";
+  try {
+    reader = readers->acquire();
+    Statement(reader, "BEGIN;").exec();
+    Statement(reader, "SELECT COUNT(*) FROM sqlite_master;").step();
+
+    sqlite3_backup *copy =
+      sqlite3_backup_init(dest, "main", reader->dbconn, "main");
+    if (!copy)
+      error = sqlite3_errmsg(dest);
+    else {
+      int res;
+      while ((res = sqlite3_backup_step(copy, BACKUP_STEP_PAGES)) !=
+             SQLITE_DONE) {
+        if (res != SQLITE_OK && res != SQLITE_BUSY && res != SQLITE_LOCKED)
+          break;
+        sqlite3_sleep(BACKUP_STEP_PAUSE);
+      }
+      if (sqlite3_backup_finish(copy) != SQLITE_OK)
+        error = sqlite3_errmsg(dest);
+    }
+  } catch (Exception &exc) {
+    error = exc.msg();
+  }
+
+  // The read transaction is ended whatever happened, so that the
+  // reader doesn't go back to the pool holding on to an old snapshot.
+
+  if (reader) {
+    if (!sqlite3_get_autocommit(reader->dbconn))
+      sqlite3_exec(reader->dbconn, "ROLLBACK;", 0, 0, 0);
+    readers->release(reader);
+  }
+  sqlite3_close(dest);
+  if (error != "")
+    throw Exception(Exception::DB_ERROR, "Backup failed: " + error);
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
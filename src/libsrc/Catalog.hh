@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   Catalog.hh
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Compile-time catalog of the document and field types defined in
+//  sql/docmgr-schema.sql, shared by the library and the applications.
+//
+//----------------------------------------------------------------------
+
+#ifndef _H_CATALOG_
+#define _H_CATALOG_
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+
+using namespace std;
+
+
+//----------------------------------------------------------------------
+//
+//  CATALOG DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+namespace DocMgr {
+  namespace Catalog {
+
+    // Field types, in the order they're shown in forms.  The name is
+    // the one used in the database and for BibTeX export (tags have
+    // no BibTeX equivalent) and the label is the one shown in forms.
+
+    struct FieldTypeDef {
+      const char *id;
+      const char *name;
+      const char *condition;
+      const char *label;
+    };
+
+    constexpr FieldTypeDef field_types[] = {
+      { "AU", "author",       "~*", "Author" },
+      { "TI", "title",        "~*", "Title" },
+
+      { "YR", "year",         "=",  "Year" },
+      { "MO", "month",        "=",  "Month" },
+
+      { "JN", "journal",      "~*", "Journal" },
+      { "VO", "volume",       "=",  "Volume" },
+      { "NO", "number",       "=",  "Number" },
+      { "PG", "pages",        "~*", "Pages" },
+
+      { "BT", "booktitle",    "~*", "Book Title" },
+      { "ED", "editor",       "~*", "Editor" },
+      { "EN", "edition",      "=",  "Edition" },
+      { "CA", "chapter",      "=",  "Chapter" },
+      { "SE", "series",       "~*", "Series" },
+
+      { "PU", "publisher",    "~*", "Publisher" },
+      { "OG", "organization", "~*", "Organization" },
+      { "IN", "institution",  "~*", "Institution" },
+      { "SH", "school",       "~*", "School" },
+      { "AD", "address",      "~*", "Address" },
+
+      { "HO", "howpublished", "~*", "How Published" },
+      { "LA", "language",     "~*", "Language" },
+      { "TY", "type",         "=",  "Type" },
+
+      { "IS", "isbn",         "=",  "ISBN" },
+      { "EP", "eprint",       "=",  "E-print" },
+      { "UR", "url",          "~*", "URL" },
+
+      { "KW", "keywords",     "~*", "Keywords" },
+      { "NT", "note",         "~*", "Note" },
+      { "TG", "",             "~*", "Tags" },
+
+      { "XR", "crossref",     "=",  "Cross Ref." }
+    };
+
+
+    // Document types.  The name is also the BibTeX entry type.
+
+    struct DocTypeDef {
+      const char *id;
+      const char *name;
+      const char *mandatory;
+    };
+
+    constexpr DocTypeDef doc_types[] = {
+      { "AT", "Article",       "(AND AU JN TI YR)" },
+      { "BK", "Book",          "(AND (OR AU ED) PU TI YR)" },
+      { "BL", "Booklet",       "TI" },
+      { "IB", "InBook",        "(AND AU (OR CA PG) TI XR)" },
+      { "IC", "InCollection",  "(AND AU TI YR XR)" },
+      { "IP", "InProceedings", "(AND AU TI YR XR)" },
+      { "MA", "Manual",        "TI" },
+      { "MT", "MastersThesis", "(AND AU SH TI YR)" },
+      { "MS", "Misc",          "" },
+      { "PH", "PhdThesis",     "(AND AU SH TI YR)" },
+      { "PR", "Proceedings",   "(AND TI YR)" },
+      { "TR", "TechReport",    "(AND AU IN TI YR)" },
+      { "UP", "Unpublished",   "(AND AU TI)" }
+    };
+
+    constexpr int NFIELD_TYPES = sizeof(field_types) / sizeof(FieldTypeDef);
+    constexpr int NDOC_TYPES = sizeof(doc_types) / sizeof(DocTypeDef);
+
+
+    // Perfect hash of two-letter upper-case codes, or -1 for anything
+    // else.
+
+    constexpr int NCODES = 26 * 26;
+
+    constexpr int code(const char *id)
+    {
+      return (id[0] >= 'A' && id[0] <= 'Z' &&
+              id[1] >= 'A' && id[1] <= 'Z' && id[2] == '\0') ?
+        (id[0] - 'A') * 26 + (id[1] - 'A') : -1;
+    }
+
+
+    // Table from codes to positions in one of the catalog arrays,
+    // built by the compiler.  A table is only usable if every ID in
+    // its array is a valid code, with no duplicates.
+
+    struct CodeTable {
+      template <typename Def, int N>
+      constexpr CodeTable(const Def (&defs)[N]) : slots(), ok(true)
+      {
+        for (int idx = 0; idx < NCODES; ++idx) slots[idx] = -1;
+        for (int idx = 0; idx < N; ++idx) {
+          int c = code(defs[idx].id);
+          if (c < 0 || slots[c] >= 0)
+            ok = false;
+          else
+            slots[c] = idx;
+        }
+      }
+
+      constexpr int find(const char *id) const
+      { return code(id) < 0 ? -1 : slots[code(id)]; }
+
+      signed char slots[NCODES];
+      bool ok;
+    };
+
+    constexpr CodeTable field_table(field_types);
+    constexpr CodeTable doc_table(doc_types);
+    static_assert(field_table.ok, "Bad or duplicate field type ID");
+    static_assert(doc_table.ok, "Bad or duplicate document type ID");
+
+
+    // Positions of field and document types in the catalog arrays, by
+    // ID, or -1 if they're not in the catalog.
+
+    constexpr int field_index(const char *id) { return field_table.find(id); }
+    constexpr int doc_index(const char *id) { return doc_table.find(id); }
+    inline int field_index(const string &id)
+    { return field_index(id.c_str()); }
+    inline int doc_index(const string &id) { return doc_index(id.c_str()); }
+  };
+};
+
+#endif
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   CatalogLoad.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Catalog loading and catalog snapshots for document manager
+//  library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// System headers.
+
+#include <unistd.h>
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL VARIABLE DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// First word of a snapshot file, followed by the schema version it
+// was made for, and the line that ends it.
+
+static const string SNAPSHOT_MAGIC = "docmgr-catalog";
+static const string SNAPSHOT_END = "end";
+
+
+//----------------------------------------------------------------------
+//
+//  FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// The whole catalog comes back from one query: document types in
+// table order, field types in ID order and the fields allowed for
+// each document type, grouped by type and in ID order.
+
+void DocMgr::read_catalog(ConnectionPriv *priv, vector<CatalogRow> &rows)
+{
+  Statement query(priv,
+                  "SELECT 0, rowid, id, doctype, mandatory FROM doc_types "
+                  "UNION ALL "
+                  "SELECT 1, 0, id, field, condition FROM field_types "
+                  "UNION ALL "
+                  "SELECT 2, 0, doctype_id, field_id, '' FROM doc_fields "
+                  "ORDER BY 1, 2, 3, 4;");
+  if (query.columns() != 5)
+    throw Exception(Exception::DB_ERROR,
+                    "Internal DB error: bad result size!");
+  while (query.step())
+    rows.push_back(CatalogRow(CatalogRow::Kind(query.integer(0)),
+                              query.text(2), query.text(3),
+                              query.text(4)));
+}
+
+
+// A snapshot is a header line giving the schema version, one line per
+// catalog row with tab-separated fields, and an end marker, so that a
+// truncated file is never taken for a complete one.  Anything out of
+// place means the snapshot isn't used.
+
+bool DocMgr::read_catalog_snapshot(string file, int version,
+                                   vector<CatalogRow> &rows)
+{
+  ifstream in(file.c_str());
+  if (!in) return false;
+
+  string line;
+  char buff[64];
+  sprintf(buff, " %d", version);
+  if (!getline(in, line) || line != SNAPSHOT_MAGIC + buff) return false;
+
+  vector<CatalogRow> snap;
+  while (getline(in, line)) {
+    if (line == SNAPSHOT_END) {
+      rows.insert(rows.end(), snap.begin(), snap.end());
+      return true;
+    }
+    string::size_type tab1 = line.find('\t');
+    if (tab1 != 1 || line[0] < '0' + CatalogRow::DOC_TYPE ||
+        line[0] > '0' + CatalogRow::DOC_FIELD) return false;
+    string::size_type tab2 = line.find('\t', tab1 + 1);
+    if (tab2 == string::npos) return false;
+    string::size_type tab3 = line.find('\t', tab2 + 1);
+    if (tab3 == string::npos) return false;
+    snap.push_back(CatalogRow(CatalogRow::Kind(line[0] - '0'),
+                              line.substr(tab1 + 1, tab2 - tab1 - 1),
+                              line.substr(tab2 + 1, tab3 - tab2 - 1),
+                              line.substr(tab3 + 1)));
+  }
+  return false;
+}
+
+
+// The snapshot is written to a temporary file and renamed into place,
+// so that a connection opened at the same time never sees half of
+// one.  It's only a cache: if it can't be written (or a value in the
+// catalog couldn't be read back), there just isn't one.
+
+void DocMgr::write_catalog_snapshot(string file, int version,
+                                    const vector<CatalogRow> &rows)
+{
+  for (int idx = 0; idx < rows.size(); ++idx)
+    if (rows[idx].id.find_first_of("\t\n") != string::npos ||
+        rows[idx].name.find_first_of("\t\n") != string::npos ||
+        rows[idx].extra.find_first_of("\t\n") != string::npos)
+      return;
+
+  char buff[64];
+  sprintf(buff, ".%d", getpid());
+  string tmpfile = file + buff;
+  {
+    ofstream out(tmpfile.c_str());
+    if (!out) return;
+    out << SNAPSHOT_MAGIC << " " << version << "\n";
+    for (int idx = 0; idx < rows.size(); ++idx)
+      out << int(rows[idx].kind) << "\t" << rows[idx].id << "\t"
+          << rows[idx].name << "\t" << rows[idx].extra << "\n";
+    out << SNAPSHOT_END << "\n";
+    out.close();
+    if (!out) {
+      remove(tmpfile.c_str());
+      return;
+    }
+  }
+  if (rename(tmpfile.c_str(), file.c_str()) != 0)
+    remove(tmpfile.c_str());
+}
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <cctype>
 #include <list>
+#include <algorithm>
 
 using namespace std;
 
@@ -31,26 +32,17 @@ using namespace std;
 #include <sqlite3.h>
 
 
-// Local header.
+// Local headers.
 
 #include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+#include "Catalog.hh"
 
 using namespace DocMgr;
 
 
 //ofstream qstr("query.sql");
 
-//----------------------------------------------------------------------
-//
-//  LOCAL TYPE DEFINITIONS
-//
-//----------------------------------------------------------------------
-
-struct DocMgr::ConnectionPriv {
-  sqlite3 *dbconn;
-};
-
-
 //----------------------------------------------------------------------
 //
 //  LOCAL FUNCTION PROTOTYPES
@@ -58,6 +50,9 @@ struct DocMgr::ConnectionPriv {
 //----------------------------------------------------------------------
 
 static string escape_string(string in_str);
+static void rethrow_record_error(Exception &exc);
+static bool text_indexable(string pattern);
+static string text_phrase(string pattern);
 
 
 //----------------------------------------------------------------------
@@ -121,45 +116,52 @@ DocID::operator string(void) const
 //
 //----------------------------------------------------------------------
 
-FieldType::FieldType(Connection &db, string poss_id)
+FieldType::FieldType(Connection &db, string poss_id) : _db(&db)
 {
-  const vector<FieldType> &ftypes = db.field_types();
-  vector<FieldType>::const_iterator it;
-  for (it = ftypes.begin(); it != ftypes.end(); ++it)
-    if (poss_id == it->id()) { *this = *it;  break; }
-  if (it == ftypes.end())
+  Connection::OrdinalMap::const_iterator it =
+    db._field_ordinals.find(poss_id);
+  if (it == db._field_ordinals.end())
     throw Exception(Exception::INVALID_FIELDTYPE,
                     string("Invalid field type: '") + poss_id + "'");
+  _ordinal = it->second;
 }
 
 bool FieldType::valid(Connection &db, string poss_id)
 {
-  const vector<FieldType> &ftypes = db.field_types();
-  for (vector<FieldType>::const_iterator it = ftypes.begin();
-       it != ftypes.end(); ++it)
-    if (poss_id == it->id()) return true;
-  return false;
+  return db._field_ordinals.find(poss_id) != db._field_ordinals.end();
+}
+
+FieldType::operator string(void) const
+{
+  return valid() ? _db->_field_info[_ordinal].id : "";
 }
 
 string FieldType::id(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_FIELDTYPE, "Uninitialised field type");
-  return _id;
+  return _db->_field_info[_ordinal].id;
 }
 
 string FieldType::name(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_FIELDTYPE, "Uninitialised field type");
-  return _name;
+  return _db->_field_info[_ordinal].name;
 }
 
 string FieldType::condition(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_FIELDTYPE, "Uninitialised field type");
-  return _condition;
+  return _db->_field_info[_ordinal].condition;
+}
+
+int FieldType::catalog(void) const
+{
+  if (!valid())
+    throw Exception(Exception::INVALID_FIELDTYPE, "Uninitialised field type");
+  return _db->_field_info[_ordinal].catalog;
 }
 
 
@@ -169,45 +171,93 @@ string FieldType::condition(void) const
 //
 //----------------------------------------------------------------------
 
-DocType::DocType(Connection &db, string poss_id)
+DocType::DocType(Connection &db, string poss_id) : _db(&db)
 {
-  const vector<DocType> &dtypes = db.doc_types();
-  vector<DocType>::const_iterator it;
-  for (it = dtypes.begin(); it != dtypes.end(); ++it)
-    if (poss_id == it->id()) { *this = *it;  break; }
-  if (it == dtypes.end())
+  Connection::OrdinalMap::const_iterator it =
+    db._doc_ordinals.find(poss_id);
+  if (it == db._doc_ordinals.end())
     throw Exception(Exception::INVALID_DOCTYPE,
                     string("Invalid document type: '") + poss_id + "'");
+  _ordinal = it->second;
 }
 
 bool DocType::valid(Connection &db, string poss_id)
 {
-  const vector<DocType> &dtypes = db.doc_types();
-  for (vector<DocType>::const_iterator it = dtypes.begin();
-       it != dtypes.end(); ++it)
-    if (poss_id == it->id()) return true;
-  return false;
+  return db._doc_ordinals.find(poss_id) != db._doc_ordinals.end();
+}
+
+DocType::operator string(void) const
+{
+  return valid() ? _db->_doc_info[_ordinal].id : "";
 }
 
 string DocType::id(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
-  return _id;
+  return _db->_doc_info[_ordinal].id;
 }
 
 string DocType::name(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
-  return _name;
+  return _db->_doc_info[_ordinal].name;
 }
 
 string DocType::mandatory(void) const
 {
   if (!valid())
     throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
-  return _mandatory;
+  return _db->_doc_info[_ordinal].mandatory;
+}
+
+int DocType::catalog(void) const
+{
+  if (!valid())
+    throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
+  return _db->_doc_info[_ordinal].catalog;
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: DocFields
+//
+//----------------------------------------------------------------------
+
+DocFields::DocFields(const Connection &db) :
+  _present(db._field_info.size(), false)
+{
+  _slots.reserve(db._field_info.size());
+  for (int idx = 0; idx < db._field_info.size(); ++idx)
+    _slots.push_back(value_type(db._field_types[idx], ""));
+}
+
+string &DocFields::operator[](FieldType field)
+{
+  int idx = slot(field);
+  _present[idx] = true;
+  return _slots[idx].second;
+}
+
+DocFields::iterator DocFields::find(FieldType field)
+{
+  int idx = slot(field);
+  return _present[idx] ? iterator(this, idx) : end();
+}
+
+DocFields::const_iterator DocFields::find(FieldType field) const
+{
+  int idx = slot(field);
+  return _present[idx] ? const_iterator(this, idx) : end();
+}
+
+int DocFields::slot(FieldType field) const
+{
+  if (field.ordinal() < 0 || field.ordinal() >= _slots.size())
+    throw Exception(Exception::INVALID_FIELDTYPE, "Uninitialised field type");
+  return field.ordinal();
 }
 
 
@@ -290,7 +340,8 @@ vector<string> Status::valid_statuses(void)
 //----------------------------------------------------------------------
 
 DocRecord::DocRecord(Connection &db, DocType type) :
-  _db(db), _type(type), _holding("-"), _status("-")
+  _db(db), _type(type), _holding("-"), _status("-"), _fields(db),
+  _saved_fields(db.field_types().size())
 {
   const vector<FieldType> &doc_fields = _db.doc_fields(type);
   for (vector<FieldType>::const_iterator it = doc_fields.begin();
@@ -300,7 +351,8 @@ DocRecord::DocRecord(Connection &db, DocType type) :
 }
 
 DocRecord::DocRecord(Connection &db, DocType type, DocID id) :
-  _db(db), _type(type), _id(id)
+  _db(db), _type(type), _id(id), _fields(db),
+  _saved_fields(db.field_types().size())
 {
   const vector<FieldType> &doc_fields = _db.doc_fields(type);
   for (vector<FieldType>::const_iterator it = doc_fields.begin();
@@ -325,9 +377,15 @@ void DocRecord::set_status(Status status)
   }
 }
 
+string DocRecord::field(FieldType field_id) const
+{
+  DocFields::const_iterator it = _fields.find(field_id);
+  return it == _fields.end() ? "" : it->second;
+}
+
 void DocRecord::set_field(FieldType field_id, string value)
 {
-  map<FieldType, string>::iterator it = _fields.find(field_id);
+  DocFields::iterator it = _fields.find(field_id);
   if (it == _fields.end())
     throw Exception(Exception::INVALID_FIELDTYPE,
                     "Invalid field type for document");
@@ -337,149 +395,82 @@ void DocRecord::set_field(FieldType field_id, string value)
 
 void DocRecord::intern(void)
 {
-  if (interned())
-    throw Exception(Exception::SEQUENCE,
-                    string("Document '") + string(_id) +
-                    "' is already interned");
-
-  // Get new record ID.
-
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
-  int res = sqlite3_get_table(_db.priv()->dbconn,
-                              "SELECT next_value FROM doc_id;",
-                              &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
-  }
-  if (nrow < 1 || ncol != 1)
-    throw Exception(Exception::DB_ERROR,
-                    "Internal DB error: bad result size!");
-  DocID new_id(rows[1]);
-  sqlite3_free_table(rows);
-  DocID next_id(static_cast<int>(new_id) + 1);
-  string cmd = "UPDATE doc_id SET next_value='" + string(next_id) + "';";
-  res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Command failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
-  }
-
+  vector<DocRecord *> docs(1, this);
+  _db.intern_docs(docs);
+}
 
-  // Insert document entry.
+// Only the changes since the record was read (or last written) are
+// sent to the database, all in one transaction.  Field values can be
+// changed through the reference returned by fields() as well as by
+// set_field, so the fields are compared with their saved values rather
+// than relying on set_field to flag them.  The changes are worked out
+// before the transaction is opened, so that saving an unchanged record
+// never waits for the write lock.
 
-  cmd = "INSERT INTO documents VALUES ('";
-  cmd += string(new_id) + "', '";
-  cmd += string(_type) + "', '";
-  cmd += string(_holding) + "', '";
-  cmd += string(_status) + "');";
-  res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Command failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+void DocRecord::update(void)
+{
+  bool doc_changed = _holding != _saved_holding || _status != _saved_status;
+  vector<DocFields::const_iterator> changed_fields;
+  for (DocFields::const_iterator it = _fields.begin();
+       it != _fields.end(); ++it)
+    if (it->second != _saved_fields[it->first.ordinal()])
+      changed_fields.push_back(it);
+  if (!doc_changed && changed_fields.empty()) return;
+
+  // The document may have been purged since the record was read, and
+  // field data written for it then would be orphaned.
+
+  Transaction trans(_db.priv());
+  {
+    Statement query(_db.priv(), "SELECT 1 FROM documents WHERE id=?;");
+    query.bind(1, _id);
+    if (!query.step())
+      throw Exception(Exception::DOCID_NOT_FOUND,
+                      string("Document ID '") + string(_id) + "' not found");
+  }
+  if (doc_changed) {
+    Statement cmd(_db.priv(), "UPDATE documents SET holding=?, status=? "
+                  "WHERE id=?;");
+    cmd.bind(1, _holding);
+    cmd.bind(2, _status);
+    cmd.bind(3, _id);
+    cmd.exec();
   }
 
-
-  // Insert document fields.
-
-  for (map<FieldType, string>::const_iterator it = _fields.begin();
-       it != _fields.end(); ++it) {
-    if (it->second == "") continue;
-    string cmd = "INSERT INTO doc_data VALUES ('";
-    cmd += string(new_id) + "', '";
-    cmd += string(it->first) + "', '";
-    cmd += escape_string(it->second) + "');";
-    int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+  for (int idx = 0; idx < changed_fields.size(); ++idx) {
+    DocFields::const_iterator it = changed_fields[idx];
+    if (it->second == "") {
+      Statement cmd(_db.priv(),
+                    "DELETE FROM doc_data WHERE doc_id=? AND field_id=?;");
+      cmd.bind(1, _id);
+      cmd.bind(2, it->first);
+      cmd.exec();
+    } else {
+      Statement cmd(_db.priv(), "INSERT INTO doc_data VALUES (?, ?, ?) "
+                    "ON CONFLICT (doc_id, field_id) "
+                    "DO UPDATE SET data=excluded.data;");
+      cmd.bind(1, _id);
+      cmd.bind(2, it->first);
+      cmd.bind(3, it->second);
+      cmd.exec();
     }
   }
 
-  _id = new_id;
+  trans.commit();
+  _db.modified();
+  clear_modified();
+  if (_db._store) _db._store->put(*this);
 }
 
-void DocRecord::update(void)
-{
-  DocRecord *existing = _db.get_doc_by_id(_id);
-  char *errmsg;
-  if (existing->holding() != _holding) {
-    string cmd = "UPDATE documents SET holding='";
-    cmd += string(_holding) + "' WHERE id='" + string(_id) + "';";
-    int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
-    }
-  }
-  if (existing->status() != _status) {
-    string cmd = "UPDATE documents SET status='";
-    cmd += string(_status) + "' WHERE id='" + string(_id) + "';";
-    int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
-    }
-  }
-
 
-  // Deal with document fields one at a time - may need to insert,
-  // update or delete....
-
-  for (map<FieldType, string>::const_iterator it = _fields.begin();
-       it != _fields.end(); ++it) {
-    string existing_field = existing->fields()[it->first];
-    string new_field = it->second;
-    if (existing_field == "" && new_field == "")
-      continue;
-    else if (existing_field == "" && new_field != "") {
-      // Insert a new one.
-
-      string cmd = "INSERT INTO doc_data VALUES ('";
-      cmd += string(_id) + "', '";
-      cmd += string(it->first) + "', '";
-      cmd += escape_string(new_field) + "');";
-      int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-      if (res != SQLITE_OK) {
-        string excmsg = string("Command failed: ") + errmsg;
-        sqlite3_free(errmsg);
-        throw Exception(Exception::DB_ERROR, excmsg);
-      }
-    } else if (existing_field != "" && new_field == "") {
-      // Delete one.
-
-      string cmd = "DELETE FROM doc_data WHERE doc_id='";
-      cmd += string(_id) + "' AND field_id='";
-      cmd += string(it->first) + "';";
-      int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-      if (res != SQLITE_OK) {
-        string excmsg = string("Command failed: ") + errmsg;
-        sqlite3_free(errmsg);
-        throw Exception(Exception::DB_ERROR, excmsg);
-      }
-    } else if (existing_field != new_field) {
-      // Update one.
-
-      string cmd = "UPDATE doc_data SET data='";
-      cmd += escape_string(new_field) + "' WHERE doc_id='";
-      cmd += string(_id) + "' AND field_id='";
-      cmd += string(it->first) + "';";
-      int res = sqlite3_exec(_db.priv()->dbconn, cmd.c_str(), 0, 0, &errmsg);
-      if (res != SQLITE_OK) {
-        string excmsg = string("Command failed: ") + errmsg;
-        sqlite3_free(errmsg);
-        throw Exception(Exception::DB_ERROR, excmsg);
-      }
-    }
-  }
+void DocRecord::clear_modified(void)
+{
+  _modified = false;
+  _saved_holding = _holding;
+  _saved_status = _status;
+  for (DocFields::const_iterator it = _fields.begin();
+       it != _fields.end(); ++it)
+    _saved_fields[it->first.ordinal()] = it->second;
 }
 
 
@@ -492,82 +483,22 @@ void DocRecord::display(ostream &ostr) const
   ostr << "   HOLDING: " << string(_holding)
        << "   STATUS: " << string(_status) << endl;
   const vector<FieldType> &field_ids = _db.doc_fields(_type);
-  DocRecord &doc = const_cast<DocRecord &>(*this);
   for (int idx = 0; idx < field_ids.size(); ++idx)
     ostr << "  " << string(field_ids[idx])
-         << ": " << doc._fields[field_ids[idx]] << endl;
+         << ": " << field(field_ids[idx]) << endl;
   ostr << endl;
 }
 
 
-bool DocRecord::mandatory_fields_ok(list<FieldType> &bad_field_types)
-{
-  return mandatory_check(_type.mandatory(), bad_field_types);
-}
+// Only fields with a non-empty value count as present.
 
-
-bool DocRecord::mandatory_check(string mandatory,
-                                list<FieldType> &bad_field_types)
+bool DocRecord::mandatory_fields_ok(list<FieldType> &bad_field_types)
 {
-  bad_field_types.clear();
-  if (mandatory == "")
-    return true;
-  else if (mandatory.find('(') == string::npos) {
-    FieldType ftype(_db, mandatory);
-    map<FieldType, string>::iterator loc = _fields.find(ftype);
-    if (loc != _fields.end() && loc->second.size() > 0)
-      return true;
-    else {
-      bad_field_types.push_back(ftype);
-      return false;
-    }
-  } else {
-    bool and_clause;
-    int clause_start_len;
-    if (mandatory.substr(0, 4) == "(AND") {
-      and_clause = true;
-      clause_start_len = 5;
-    } else {
-      and_clause = false;
-      clause_start_len = 4;
-    }
-
-    string field_name_str =
-      mandatory.substr(clause_start_len,
-                       mandatory.size() - clause_start_len - 1);
-    list<string> field_names;
-    while (field_name_str.find(' ') != string::npos ||
-           field_name_str[0] == '(') {
-      if (field_name_str[0] == '(') {
-        field_names.push_back(field_name_str.substr
-                              (0, field_name_str.find(')') + 1));
-        field_name_str = field_name_str.substr(field_name_str.find(')') + 2);
-      } else {
-        field_names.push_back(field_name_str.substr
-                              (0, field_name_str.find(' ')));
-        field_name_str = field_name_str.substr(field_name_str.find(' ') + 1);
-      }
-    }
-    field_names.push_back(field_name_str);
-
-    if (and_clause) {
-      for (list<string>::iterator it = field_names.begin();
-           it != field_names.end(); ++it)
-        if (!mandatory_check(*it, bad_field_types)) return false;
-      return true;
-    } else {
-      for (list<string>::iterator it = field_names.begin();
-           it != field_names.end(); ++it)
-        if (mandatory_check(*it, bad_field_types)) return true;
-      bad_field_types.clear();
-      for (list<string>::iterator it = field_names.begin();
-           it != field_names.end(); ++it) {
-        FieldType ftype(_db, mandatory);
-        bad_field_types.push_back(ftype);
-      }
-      return false;
-    }
-  }
+  Connection::FieldMask present;
+  for (DocFields::const_iterator it = _fields.begin();
+       it != _fields.end(); ++it)
+    if (it->second.size() > 0) present.set(it->first.ordinal());
+  return _db.mandatory_ok(_type, present, bad_field_types);
 }
 
 
@@ -762,15 +693,97 @@ Query Query::operator||(const Query &other)
 
 Query::operator string(void) const
 {
-  string result = process_tree(_tree);
-  result += ";";
-  return result;
+  return sql("") + " ORDER BY d.id;";
 }
 
 
+// Connections with a memory store evaluate queries against it
+// directly; the database is only used for cursors and background
+// queries.
+
 void Query::run(vector<DocID> &ids)
 {
-  _db->get_ids((string)(*this), ids);
+  DocStore *store = _db->store();
+  if (store) {
+    DocSet result;
+    evaluate(*store, result);
+    store->collect(result, ids);
+  } else
+    _db->get_ids((string)(*this), ids);
+}
+
+
+int Query::count(void) const
+{
+  DocStore *store = _db->store();
+  if (store) {
+    DocSet result;
+    evaluate(*store, result);
+    return result.count();
+  }
+  return _db->count_ids((string)(*this));
+}
+
+
+QueryJob *Query::run_async(void) const
+{
+  return new QueryJob(*_db, (string)(*this));
+}
+
+
+bool Query::contains(DocID id) const
+{
+  DocStore *store = _db->store();
+  if (store) {
+    if (!DocID::valid(static_cast<int>(id))) return false;
+    DocSet result;
+    evaluate(*store, result);
+    return result.contains(store->index_of(id));
+  }
+
+  char buff[32];
+  sprintf(buff, "d.id = %d", static_cast<int>(id));
+  QueryCursor cursor(*_db, sql(buff));
+  DocID found;
+  return cursor.next(found);
+}
+
+
+// SQL for the query, with an optional extra condition on the
+// document ID, d.id.
+//
+// Deleted documents are dropped by the database engine itself, using
+// the primary key of deleted_ids, rather than being returned and
+// filtered out afterwards.
+//
+// If the set of IDs matching the most selective term of the query
+// can be computed directly, it is used as the list of candidates,
+// rather than scanning the documents table.
+
+string Query::sql(string cond) const
+{
+  vector<QTreeNode *> terms;
+  if (_tree) and_terms(_tree, terms);
+  stable_sort(terms.begin(), terms.end(), more_selective);
+
+  string result = "SELECT d.id FROM documents d";
+  string where = cond;
+  for (int idx = 0; idx < terms.size(); ++idx) {
+    string set = idx == 0 ? match_set(terms[0]) : "";
+    if (set != "")
+      result = "WITH d (id) AS (" + set + ") SELECT d.id FROM d";
+    else {
+      if (where != "") where += " AND ";
+      where += process_tree(terms[idx], idx != 0);
+    }
+  }
+  if (!_db->view_deleted()) {
+    if (where != "") where += " AND ";
+    where += "NOT EXISTS (SELECT 1 FROM deleted_ids WHERE id = d.id)";
+  }
+
+  if (where != "") result += " WHERE " + where;
+  return result;
 }
 
 
@@ -853,99 +866,304 @@ Query::QTreeNode *Query::copy_tree(Query::QTreeNode *orig)
 }
 
 
-string Query::process_tree(Query::QTreeNode *node)
+// Queries are compiled into a single SELECT, with the query tree
+// turned into a condition on each candidate document ID, d.id.  A
+// condition can take one of two forms: a "driving" form, which
+// computes the set of matching IDs once and so can be used to pick
+// out candidate documents, and a "filter" form, which checks a single
+// candidate by primary key lookups.  In each conjunction, the term
+// expected to match the fewest documents is used in driving form and
+// the rest are checked as filters on the documents it finds.  The
+// driving form may refer to the columns of the documents table; the
+// filter form only uses the document ID.
+
+string Query::process_tree(Query::QTreeNode *node, bool filter)
 {
   string retval = "";
-  if (!node)
-    retval = "SELECT DISTINCT doc_id FROM doc_data";
-  else {
-    switch (node->type) {
-    case EMPTY:
-      break;
+  switch (node->type) {
+  case EMPTY:
+    retval = "1";
+    break;
 
-    case QUICK: {
-      string quick = *node->quick;
-      list<string> words;
-      while (quick.find(' ') != string::npos) {
-        words.push_back(quick.substr(0, quick.find(' ')));
-        quick.erase(0, quick.find(' ') + 1);
-      }
-      words.push_back(quick);
-
-      retval = "SELECT DISTINCT doc_id FROM doc_data WHERE ";
-      for (list<string>::iterator it = words.begin();
-           it != words.end(); ++it) {
-        if (it != words.begin())
-          retval += " OR ";
-        string word = *it;
-        retval += "data LIKE '%";
-        retval += escape_string(word);
-        retval += "%' OR data LIKE '%";
-        retval += escape_string(word.substr(0, 1));
-        retval += '}';
-        retval += escape_string(word.substr(1));
-        retval += "%'";
-      }
-      break;
-    }
+  case QUICK:
+    retval = "d.id IN (" + match_set(node) + ")";
+    break;
 
-    case STATUS: {
-      retval = "SELECT DISTINCT id FROM documents WHERE status='";
-      retval += string(*node->status) + "'";
-      break;
+  case STATUS:
+    if (filter)
+      retval = "EXISTS (SELECT 1 FROM documents WHERE id = d.id "
+        "AND status = '" + string(*node->status) + "')";
+    else
+      retval = "d.status = '" + string(*node->status) + "'";
+    break;
+
+  case HOLDING:
+    if (filter)
+      retval = "EXISTS (SELECT 1 FROM documents WHERE id = d.id "
+        "AND holding = '" + string(*node->holding) + "')";
+    else
+      retval = "d.holding = '" + string(*node->holding) + "'";
+    break;
+
+  case SIMPLE: {
+    string val = node->clause->second;
+    string field_id = node->clause->first.id();
+    if (!filter)
+      retval = "d.id IN (" + match_set(node) + ")";
+    else if (node->clause->first.condition() == "=")
+      retval = "EXISTS (SELECT 1 FROM doc_data WHERE doc_id = d.id "
+        "AND field_id = '" + field_id + "' AND data = '" +
+        escape_string(val) + "')";
+    else if (node->clause->first.condition() == "~*") {
+      string brace_val = val.substr(0, 1) + '}' + val.substr(1);
+      retval = "EXISTS (SELECT 1 FROM doc_data WHERE doc_id = d.id "
+        "AND field_id = '" + field_id + "' AND (data LIKE '%" +
+        escape_string(val) + "%' OR data LIKE '%" +
+        escape_string(brace_val) + "%'))";
     }
+    break;
+  }
 
-    case HOLDING: {
-      retval = "SELECT DISTINCT id FROM documents WHERE holding='";
-      retval += string(*node->holding) + "'";
-      break;
+  case AND: {
+    vector<QTreeNode *> terms;
+    and_terms(node, terms);
+    stable_sort(terms.begin(), terms.end(), more_selective);
+    retval = "(";
+    for (int idx = 0; idx < terms.size(); ++idx) {
+      if (idx != 0) retval += " AND ";
+      retval += process_tree(terms[idx], filter || idx != 0);
     }
+    retval += ")";
+    break;
+  }
+
+  case OR:
+    retval = "(" + process_tree(node->node1, filter) + " OR " +
+      process_tree(node->node2, filter) + ")";
+    break;
+  }
+  return retval;
+}
+
+
+// Rough estimates of the fraction of documents matched by each kind
+// of condition.  These only need to be good enough to put the terms
+// of a conjunction in a sensible order: an exact field match picks
+// out a handful of documents, a substring match rather more, and
+// there are only a few possible status and holding values.
+
+double Query::selectivity(Query::QTreeNode *node)
+{
+  switch (node->type) {
+  case EMPTY:   return 1.0;
+  case QUICK:   return 0.2;
+  case STATUS:  return 0.3;
+  case HOLDING: return 0.3;
+  case SIMPLE:
+    return node->clause->first.condition() == "=" ? 0.01 : 0.1;
+  case AND:
+    return selectivity(node->node1) * selectivity(node->node2);
+  case OR:
+    return min(1.0, selectivity(node->node1) + selectivity(node->node2));
+  }
+  return 1.0;
+}
+
+bool Query::more_selective(QTreeNode *a, QTreeNode *b)
+{
+  return selectivity(a) < selectivity(b);
+}
 
-    case SIMPLE: {
-      string val = node->clause->second;
-      retval = "SELECT DISTINCT doc_id FROM doc_data WHERE field_id='";
-      retval += node->clause->first.id();
-      retval += "' AND ";
-      if (node->clause->first.condition() == "=") {
-        retval += "data = '";
-        retval += escape_string(val);
-        retval += "'";
-      } else if (node->clause->first.condition() == "~*") {
-        retval += "(data LIKE '%";
-        retval += escape_string(val);
-        retval += "%' OR data LIKE '%";
-        retval += escape_string(node->clause->second.substr(0, 1));
-        retval += '}';
-        retval += escape_string(node->clause->second.substr(1));
-        retval += "%')";
+void Query::and_terms(Query::QTreeNode *node, vector<QTreeNode *> &terms)
+{
+  if (node->type == AND) {
+    and_terms(node->node1, terms);
+    and_terms(node->node2, terms);
+  } else
+    terms.push_back(node);
+}
+
+
+// The set of document IDs matching a query term, as a SELECT
+// statement, or an empty string for terms that can't sensibly be
+// computed as a set on their own.
+
+string Query::match_set(Query::QTreeNode *node)
+{
+  string retval = "";
+  switch (node->type) {
+  case QUICK: {
+    // Patterns of three or more characters can be looked up in the
+    // trigram full-text index; anything shorter needs a scan of the
+    // field data.  The trigram tokenizer folds case for all of
+    // Unicode, but LIKE (and the memory store) only for ASCII, so the
+    // documents found in the index are checked against their field
+    // data with LIKE, to give the same results either way.
+
+    vector<string> patterns;
+    quick_patterns(*node->quick, patterns);
+
+    string match = "", recheck = "", like = "";
+    for (vector<string>::iterator it = patterns.begin();
+         it != patterns.end(); ++it) {
+      if (text_indexable(*it)) {
+        if (match != "") match += " OR ";
+        match += text_phrase(*it);
+        if (recheck != "") recheck += " OR ";
+        recheck += "doc_data.data LIKE '%" + escape_string(*it) + "%'";
+      } else {
+        if (like != "") like += " OR ";
+        like += "data LIKE '%" + escape_string(*it) + "%'";
       }
-      break;
     }
 
-    case AND:
-      retval = process_tree(node->node1);
-      retval += " INTERSECT ";
-      retval += process_tree(node->node2);
-      break;
+    string text_query = "SELECT doc_data.doc_id FROM doc_text, doc_data "
+      "WHERE doc_text MATCH '" + escape_string(match) + "'"
+      " AND doc_data.doc_id = doc_text.rowid / 65536"
+      " AND doc_data.field_id = char(doc_text.rowid / 256 % 256,"
+      " doc_text.rowid % 256) AND (" + recheck + ")";
+    string data_query = "SELECT doc_id FROM doc_data WHERE " + like;
+    if (like == "")
+      retval = "SELECT DISTINCT doc_id FROM (" + text_query + ")";
+    else if (match == "")
+      retval = "SELECT DISTINCT doc_id FROM (" + data_query + ")";
+    else
+      retval = "SELECT DISTINCT doc_id FROM (" + text_query +
+        " UNION " + data_query + ")";
+    break;
+  }
 
-    case OR:
-      retval = process_tree(node->node1);
-      retval += " UNION ";
-      retval += process_tree(node->node2);
-      break;
+  case SIMPLE: {
+    string val = node->clause->second;
+    retval = "SELECT DISTINCT doc_id FROM doc_data WHERE field_id='";
+    retval += node->clause->first.id();
+    retval += "' AND ";
+    if (node->clause->first.condition() == "=") {
+      retval += "data = '";
+      retval += escape_string(val);
+      retval += "'";
+    } else if (node->clause->first.condition() == "~*") {
+      string brace_val = val.substr(0, 1) + '}' + val.substr(1);
+      string like = "(doc_data.data LIKE '%" + escape_string(val) +
+        "%' OR doc_data.data LIKE '%" + escape_string(brace_val) + "%')";
+      if (!text_indexable(val) || !text_indexable(brace_val))
+        retval += like;
+      else {
+        // Substring matches are looked up in the trigram index,
+        // restricted to entries for this field, and the candidates
+        // are then checked against the field data itself.  There is
+        // one index entry per field, so the results are distinct.
+
+        string field_id = node->clause->first.id();
+        char buff[16];
+        sprintf(buff, "%d", (static_cast<unsigned char>(field_id[0]) << 8) |
+                static_cast<unsigned char>(field_id[1]));
+        retval = "SELECT doc_data.doc_id FROM doc_text, doc_data "
+          "WHERE doc_text MATCH '" +
+          escape_string(text_phrase(val) + " OR " + text_phrase(brace_val)) +
+          "' AND doc_text.rowid % 65536 = " + buff +
+          " AND doc_data.doc_id = doc_text.rowid / 65536"
+          " AND doc_data.field_id='" +
+          field_id + "' AND " + like;
+      }
     }
+    break;
+  }
+
+  case STATUS:
+    retval = "SELECT id FROM documents WHERE status = '" +
+      string(*node->status) + "'";
+    break;
+
+  case HOLDING:
+    retval = "SELECT id FROM documents WHERE holding = '" +
+      string(*node->holding) + "'";
+    break;
+
+  case OR: {
+    string set1 = match_set(node->node1), set2 = match_set(node->node2);
+    if (set1 != "" && set2 != "")
+      retval = set1 + " UNION " + set2;
+    break;
+  }
+
+  default:
+    break;
   }
   return retval;
 }
 
 
+// Each word of a quick search is matched as a substring, both as it
+// is and with a closing brace after the first character, so that a
+// search for "Ostlund" finds "{\"O}stlund".
+
+void DocMgr::quick_patterns(string quick, vector<string> &patterns)
+{
+  list<string> words;
+  while (quick.find(' ') != string::npos) {
+    words.push_back(quick.substr(0, quick.find(' ')));
+    quick.erase(0, quick.find(' ') + 1);
+  }
+  words.push_back(quick);
+
+  patterns.clear();
+  for (list<string>::iterator it = words.begin(); it != words.end(); ++it) {
+    patterns.push_back(*it);
+    if (!it->empty())
+      patterns.push_back(it->substr(0, 1) + '}' + it->substr(1));
+  }
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: QueryCursor
+//
+//----------------------------------------------------------------------
+
+QueryCursor::QueryCursor(const Query &query) :
+  _db(*query._db), _stmt(new Statement(_db.priv(), (string)query)),
+  _done(false)
+{ }
+
+QueryCursor::QueryCursor(Connection &db, string sql) :
+  _db(db), _stmt(new Statement(_db.priv(), sql + ";")), _done(false)
+{ }
+
+QueryCursor::~QueryCursor()
+{
+  delete _stmt;
+}
+
+bool QueryCursor::next(DocID &id)
+{
+  if (_done) return false;
+  if (!_stmt->step()) { _done = true;  return false; }
+  id = DocID(_stmt->integer(0));
+  return true;
+}
+
+DocRecord *QueryCursor::next_doc(void)
+{
+  DocID id;
+  if (!next(id)) return 0;
+  return _db.get_doc_by_id(id);
+}
+
+
 //----------------------------------------------------------------------
 //
 //  MEMBER FUNCTION DEFINITIONS: Connection
 //
 //----------------------------------------------------------------------
 
-Connection::Connection(string dbfile) : _priv(new ConnectionPriv())
+Connection::Connection(string dbfile, bool memory_store,
+                       bool catalog_snapshot) :
+  _priv(new ConnectionPriv()), _deleted(MAX_DOC_IDS, false),
+  _view_deleted(false), _generation(0), _data_version(0),
+  _cache_hits(0), _cache_misses(0), _store(0), _journals(0),
+  _merging(true), _vacuuming(false), _vacuum_failed(false)
 {
   // Connect to database.
 
@@ -959,191 +1177,446 @@ Connection::Connection(string dbfile) : _priv(new ConnectionPriv())
     throw Exception(Exception::DB_ERROR,
                     string("Failed to connect to database: ") +
                     sqlite3_errmsg(_priv->dbconn));
+  _priv->dbfile = dbf;
 
 
-  // Retrieve document type data.
+  // The database is kept in WAL mode, so that queries running in the
+  // background on the pool of read-only connections don't block
+  // writes through this one, or each other.  Writes may still have
+  // to wait for each other, or for a checkpoint.
 
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
-  res = sqlite3_get_table(_priv->dbconn,
-                          "SELECT id, doctype, mandatory FROM doc_types;",
-                          &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
-  }
+  sqlite3_busy_timeout(_priv->dbconn, BUSY_TIMEOUT);
+  Statement(_priv, "PRAGMA journal_mode=WAL;").exec();
+  int readers = thread::hardware_concurrency();
+  if (readers < 1) readers = 1;
+  if (readers > MAX_READERS) readers = MAX_READERS;
+  _priv->readers = new ReaderPool(dbf, readers);
+
+
+  // Bring older databases up to date and make sure that all the
+  // indexes we rely on are there.
+
+  int version = migrate_schema(_priv);
+  check_indexes(_priv);
 
-  if (nrow < 1 || ncol != 3)
-    throw Exception(Exception::DB_ERROR,
-                    "Internal DB error: bad result size!");
 
-  for (int dtype = 0; dtype < nrow; ++dtype) {
-    char *id = rows[ncol * (dtype + 1) + 0];
-    char *doctype = rows[ncol * (dtype + 1) + 1];
-    char *mandatory = rows[ncol * (dtype + 1) + 2];
-    _doc_types.push_back(DocType(id, doctype, mandatory));
+  // Retrieve the document and field type catalog, from the snapshot
+  // if there's a good one, otherwise from the database (saving a new
+  // snapshot for next time).
+
+  vector<CatalogRow> catalog;
+  string snapshot = dbf + CATALOG_SNAPSHOT_SUFFIX;
+  if (!catalog_snapshot ||
+      !read_catalog_snapshot(snapshot, version, catalog)) {
+    read_catalog(_priv, catalog);
+    if (catalog_snapshot)
+      write_catalog_snapshot(snapshot, version, catalog);
   }
+  load_catalog(catalog);
+
 
-  sqlite3_free_table(rows);
+  // Keep a map of deleted documents, indexed by document ID, so that
+  // checks don't need to go back to the database.
 
+  load_deleted();
 
-  // Retrieve field type data.
 
-  res = sqlite3_get_table(_priv->dbconn,
-                          "SELECT id, field, condition FROM field_types;",
-                          &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+  // The memory store is loaded as of the current data version, so
+  // that only later changes by other connections cause a reload.
+
+  if (memory_store) {
+    write_generation();
+    _store = new DocStore();
+    _store->load(_priv);
   }
+}
+
+
+Connection::~Connection()
+{
+  delete _store;
+  delete _journals;
+  delete _priv;
+}
+
+
+int Connection::schema_version(void)
+{
+  return DocMgr::schema_version(_priv);
+}
+
 
-  if (nrow < 1 || ncol != 3)
+DocID Connection::max_doc_id(void)
+{
+  Statement query(_priv, "SELECT MAX(id) FROM documents;");
+  if (!query.step() || query.columns() != 1)
     throw Exception(Exception::DB_ERROR,
                     "Internal DB error: bad result size!");
 
-  for (int ftype = 0; ftype < nrow; ++ftype) {
-    char *id = rows[ncol * (ftype + 1) + 0];
-    char *field = rows[ncol * (ftype + 1) + 1];
-    char *condition = rows[ncol * (ftype + 1) + 2];
-    _field_types.push_back(FieldType(id, field, condition));
-  }
+  if (query.null(0))
+    throw Exception(Exception::DB_ERROR, "Database is currently empty");
+  return DocID(query.integer(0));
+}
+
+
+void Connection::get_deleted_ids(vector<DocID> &ids)
+{
+  Statement query(_priv, "SELECT id FROM deleted_ids;");
+  ids.clear();
+  while (query.step())
+    ids.push_back(DocID(query.integer(0)));
+}
 
-  sqlite3_free_table(rows);
 
+const vector<FieldType> &Connection::doc_fields(DocType doc_type)
+{
+  if (doc_type.ordinal() < 0 || doc_type.ordinal() >= _doc_info.size())
+    throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
+  return _doc_info[doc_type.ordinal()].fields;
+}
 
-  // Retrieve document field data.
 
-  for (vector<DocType>::const_iterator it = _doc_types.begin();
-       it != _doc_types.end(); ++it) {
-    string id = it->id();
-    string query = string("SELECT field_id FROM doc_fields ") +
-      string ("WHERE doctype_id ='") + id + "';";
+// Set up the document and field types from the catalog rows,
+// replacing any already loaded.  Field types are numbered in ID order,
+// so that the fields of a document are listed in ID order.  Rows for
+// document types that don't exist are ignored.
 
-    res = sqlite3_get_table(_priv->dbconn, query.c_str(),
-                            &rows, &nrow, &ncol, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Query failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+void Connection::load_catalog(const vector<CatalogRow> &rows)
+{
+  _doc_types.clear();
+  _field_types.clear();
+  _doc_info.clear();
+  _field_info.clear();
+  _doc_ordinals.clear();
+  _field_ordinals.clear();
+
+  for (int idx = 0; idx < rows.size(); ++idx) {
+    const CatalogRow &row = rows[idx];
+    switch (row.kind) {
+    case CatalogRow::DOC_TYPE: {
+      DocTypeInfo info;
+      info.id = row.id;
+      info.name = row.name;
+      info.mandatory = row.extra;
+      info.catalog = Catalog::doc_index(info.id);
+      if (info.catalog >= 0 &&
+          info.name != Catalog::doc_types[info.catalog].name)
+        info.catalog = -1;
+      _doc_ordinals[info.id] = _doc_info.size();
+      _doc_types.push_back(DocType(this, _doc_info.size()));
+      _doc_info.push_back(info);
+      break;
     }
+    case CatalogRow::FIELD_TYPE: {
+      FieldTypeInfo info;
+      info.id = row.id;
+      info.name = row.name;
+      info.condition = row.extra;
+      info.catalog = Catalog::field_index(info.id);
+      if (info.catalog >= 0 &&
+          info.name != Catalog::field_types[info.catalog].name)
+        info.catalog = -1;
+      _field_ordinals[info.id] = _field_info.size();
+      _field_types.push_back(FieldType(this, _field_info.size()));
+      _field_info.push_back(info);
+      break;
+    }
+    case CatalogRow::DOC_FIELD: {
+      OrdinalMap::const_iterator type = _doc_ordinals.find(row.id);
+      if (type == _doc_ordinals.end()) break;
+      DocTypeInfo &info = _doc_info[type->second];
+      info.fields.push_back(FieldType(*this, row.name));
+      info.allowed.set(info.fields.back().ordinal());
+      break;
+    }
+    }
+  }
 
-    if (nrow < 1 || ncol != 1)
+  if (_doc_types.size() < 1 ||
+      _field_types.size() < 1 || _field_types.size() > FieldMask().size())
+    throw Exception(Exception::DB_ERROR,
+                    "Internal DB error: bad result size!");
+  for (int idx = 0; idx < _doc_info.size(); ++idx)
+    if (_doc_info[idx].fields.size() < 1)
       throw Exception(Exception::DB_ERROR,
                       "Internal DB error: bad result size!");
 
-    vector<FieldType> fields;
-    for (int field = 0; field < nrow; ++field)
-      fields.push_back(FieldType(*this, rows[field + 1]));
-    _doc_fields[*it] = fields;
+  // Compile the mandatory field rules, so that checking a document
+  // doesn't need to parse them again.
 
-    sqlite3_free_table(rows);
+  for (int idx = 0; idx < _doc_info.size(); ++idx) {
+    const string &expr = _doc_info[idx].mandatory;
+    string::size_type pos = 0;
+    MandatoryRule &rule = _doc_info[idx].rule;
+    rule.any = false;
+    while (pos < expr.size()) compile_rule(expr, pos, rule);
   }
 }
 
 
-Connection::~Connection()
+// (Re)load the map of deleted documents from the database.
+
+void Connection::load_deleted(void)
 {
-  sqlite3_close(_priv->dbconn);
-  delete _priv;
+  _deleted.assign(MAX_DOC_IDS, false);
+  Statement deleted(_priv, "SELECT id FROM deleted_ids;");
+  while (deleted.step()) {
+    int id = deleted.integer(0);
+    if (id > 0 && id < _deleted.size()) _deleted[id] = true;
+  }
 }
 
 
-DocID Connection::max_doc_id(void)
+// Compile one term of a mandatory field rule, starting at pos, and
+// add it to the rule.  A rule with a single clause, as in the usual
+// "(AND AU TI YR)", is replaced by that clause.
+
+void Connection::compile_rule(const string &expr, string::size_type &pos,
+                              MandatoryRule &rule)
 {
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
-  int res = sqlite3_get_table(_priv->dbconn,
-                              "SELECT MAX(id) FROM documents;",
-                              &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+  while (pos < expr.size() && expr[pos] == ' ') ++pos;
+  if (pos >= expr.size()) return;
+  if (expr[pos] == '(') {
+    string::size_type end = expr.find_first_of(" ()", ++pos);
+    string op = expr.substr(pos, end - pos);
+    if (op != "AND" && op != "OR")
+      throw Exception(Exception::DB_ERROR,
+                      "Bad mandatory field rule: " + expr);
+    MandatoryRule clause;
+    clause.any = op == "OR";
+    pos = end;
+    while (true) {
+      while (pos < expr.size() && expr[pos] == ' ') ++pos;
+      if (pos >= expr.size())
+        throw Exception(Exception::DB_ERROR,
+                        "Bad mandatory field rule: " + expr);
+      if (expr[pos] == ')') { ++pos;  break; }
+      compile_rule(expr, pos, clause);
+    }
+    if (rule.terms.empty() && pos >= expr.size()) {
+      rule = clause;
+      return;
+    }
+    rule.terms.push_back(make_pair(FieldType(), int(rule.clauses.size())));
+    rule.clauses.push_back(clause);
+  } else {
+    string::size_type end = expr.find_first_of(" ()", pos);
+    if (end == string::npos) end = expr.size();
+    string id = expr.substr(pos, end - pos);
+    OrdinalMap::const_iterator loc = _field_ordinals.find(id);
+    if (id == "" || loc == _field_ordinals.end())
+      throw Exception(Exception::DB_ERROR,
+                      "Bad mandatory field rule: " + expr);
+    rule.mask.set(loc->second);
+    rule.terms.push_back(make_pair(_field_types[loc->second], -1));
+    pos = end;
   }
+}
 
-  if (nrow != 1 || ncol != 1)
-    throw Exception(Exception::DB_ERROR,
-                    "Internal DB error: bad result size!");
 
-  char *id_str = rows[1];
-  if (id_str[0] == '\0')
-    throw Exception(Exception::DB_ERROR, "Database is currently empty");
-  DocID id(id_str);
-  sqlite3_free_table(rows);
-  return id;
+// If a document fails its rule, the fields reported as missing are
+// the first missing term of an AND clause, or every term of an OR
+// clause, e.g. both AU and ED for "(AND (OR AU ED) TI)".
+
+bool Connection::mandatory_ok(DocType type, const FieldMask &present,
+                              list<FieldType> &bad_field_types) const
+{
+  if (type.ordinal() < 0 || type.ordinal() >= _doc_info.size())
+    throw Exception(Exception::INVALID_DOCTYPE, "Uninitialised document type");
+  const MandatoryRule &rule = _doc_info[type.ordinal()].rule;
+  bad_field_types.clear();
+  if (rule.holds(present)) return true;
+  rule.missing(present, bad_field_types);
+  return false;
 }
 
 
-void Connection::get_deleted_ids(vector<DocID> &ids)
+bool Connection::MandatoryRule::holds(const FieldMask &present) const
 {
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
-  int res = sqlite3_get_table(_priv->dbconn,
-                              "SELECT id FROM deleted_ids;",
-                              &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+  if (any) {
+    if ((present & mask).any()) return true;
+    for (int idx = 0; idx < clauses.size(); ++idx)
+      if (clauses[idx].holds(present)) return true;
+    return false;
+  } else {
+    if ((present & mask) != mask) return false;
+    for (int idx = 0; idx < clauses.size(); ++idx)
+      if (!clauses[idx].holds(present)) return false;
+    return true;
   }
+}
 
-  if (nrow > 0 && ncol != 1)
+
+void Connection::MandatoryRule::missing(const FieldMask &present,
+                                        list<FieldType> &bad_field_types) const
+{
+  for (int idx = 0; idx < terms.size(); ++idx) {
+    int clause = terms[idx].second;
+    if (any) {
+      if (clause < 0)
+        bad_field_types.push_back(terms[idx].first);
+      else
+        clauses[clause].missing(present, bad_field_types);
+    } else if (clause < 0) {
+      if (!present.test(terms[idx].first.ordinal())) {
+        bad_field_types.push_back(terms[idx].first);
+        return;
+      }
+    } else if (!clauses[clause].holds(present)) {
+      clauses[clause].missing(present, bad_field_types);
+      return;
+    }
+  }
+}
+
+
+bool Connection::doc_deleted(DocID id) const
+{
+  int idx = id;
+  return idx > 0 && idx < _deleted.size() && _deleted[idx];
+}
+
+
+// Changes made through this connection bump the write generation
+// directly.  Changes committed by other connections are picked up
+// from SQLite's data version, which changes whenever another
+// connection commits a change to the database file.
+
+unsigned long Connection::write_generation(void)
+{
+  Statement query(_priv, "PRAGMA data_version;");
+  if (!query.step())
     throw Exception(Exception::DB_ERROR,
                     "Internal DB error: bad result size!");
-
-  ids.clear();
-  for (int idx = 0; idx < nrow; ++idx) {
-    char *id = rows[idx + 1];
-    ids.push_back(DocID(id));
+  int version = query.integer(0);
+  if (version != _data_version) {
+    _data_version = version;
+    modified();
+    load_deleted();
+    if (_store) _store->load(_priv);
   }
+  return _generation;
+}
+
+
+// The memory store is reloaded if another connection has changed the
+// database since it was last used.
 
-  sqlite3_free_table(rows);
+DocStore *Connection::store(void)
+{
+  if (_store) write_generation();
+  return _store;
 }
 
 
 void Connection::get_ids(string query, vector<DocID> &ids)
 {
-  vector<DocID> deleted_ids;
-  if (!_view_deleted) get_deleted_ids(deleted_ids);
-  int del_size = deleted_ids.size();
+  unsigned long generation = write_generation();
+  map<string, CachedResult>::iterator it = _query_cache.find(query);
+  if (it != _query_cache.end() && it->second.generation == generation &&
+      it->second.have_ids) {
+    ++_cache_hits;
+    ids = it->second.ids;
+    return;
+  }
+  ++_cache_misses;
 
   ids.clear();
 
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
   //  qstr << query << endl;
-  int res = sqlite3_get_table(_priv->dbconn, query.c_str(),
-                              &rows, &nrow, &ncol, &errmsg);
-
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
-  }
-
-  if (nrow > 0 && ncol != 1)
+  Statement stmt(_priv, query);
+  if (stmt.columns() != 1)
     throw Exception(Exception::DB_ERROR,
                     "Internal DB error: bad result size!");
 
-  for (int idx = 0; idx < nrow; ++idx) {
-    DocID id = rows[idx + 1];
-    bool deleted = false;
-    for (int check = 0; check < deleted_ids.size(); ++check)
-      if (deleted_ids[check] == id) {
-        deleted = true;
-        break;
+  while (stmt.step())
+    ids.push_back(stmt.integer(0));
+
+
+  cache_ids(query, generation, ids);
+}
+
+
+// Results from older generations are of no further use, so the cache
+// is just emptied when it gets too big.
+
+void Connection::cache_ids(string query, unsigned long generation,
+                           const vector<DocID> &ids)
+{
+  if (_query_cache.size() >= QUERY_CACHE_SIZE) _query_cache.clear();
+  CachedResult &entry = _query_cache[query];
+  entry.generation = generation;
+  entry.have_ids = true;
+  entry.ids = ids;
+  entry.count = ids.size();
+}
+
+
+// Count the results of several queries at once, running those whose
+// counts aren't already cached in parallel on the read-only
+// connections.  With the memory store, counting is cheap enough to
+// just do each one in turn.
+
+void Connection::count_queries(const vector<Query> &queries,
+                               vector<int> &counts)
+{
+  counts.assign(queries.size(), 0);
+  if (store()) {
+    for (int idx = 0; idx < queries.size(); ++idx)
+      counts[idx] = queries[idx].count();
+    return;
+  }
+
+  unsigned long generation = write_generation();
+  vector<QueryJob *> jobs(queries.size(), static_cast<QueryJob *>(0));
+  try {
+    for (int idx = 0; idx < queries.size(); ++idx) {
+      string query = queries[idx];
+      map<string, CachedResult>::iterator it = _query_cache.find(query);
+      if (it != _query_cache.end() && it->second.generation == generation) {
+        ++_cache_hits;
+        counts[idx] = it->second.count;
+      } else {
+        ++_cache_misses;
+        jobs[idx] = new QueryJob(*this, query);
       }
-    if (!deleted)
-      ids.push_back(id);
+    }
+    for (int idx = 0; idx < jobs.size(); ++idx)
+      if (jobs[idx]) counts[idx] = jobs[idx]->results().size();
+  } catch (Exception &exc) {
+    for (int idx = 0; idx < jobs.size(); ++idx) delete jobs[idx];
+    throw;
+  }
+  for (int idx = 0; idx < jobs.size(); ++idx) delete jobs[idx];
+}
+
+
+int Connection::count_ids(string query)
+{
+  unsigned long generation = write_generation();
+  map<string, CachedResult>::iterator it = _query_cache.find(query);
+  if (it != _query_cache.end() && it->second.generation == generation) {
+    ++_cache_hits;
+    return it->second.count;
   }
+  ++_cache_misses;
 
-  sqlite3_free_table(rows);
+  string count_query = query;
+  if (count_query[count_query.size() - 1] == ';')
+    count_query.erase(count_query.size() - 1);
+  Statement stmt(_priv, "SELECT count(*) FROM (" + count_query + ");");
+  if (!stmt.step() || stmt.columns() != 1)
+    throw Exception(Exception::DB_ERROR,
+                    "Internal DB error: bad result size!");
+  int count = stmt.integer(0);
+
+  if (_query_cache.size() >= QUERY_CACHE_SIZE) _query_cache.clear();
+  CachedResult &entry = _query_cache[query];
+  entry.generation = generation;
+  entry.have_ids = false;
+  entry.ids.clear();
+  entry.count = count;
+  return count;
 }
 
 
@@ -1153,81 +1626,44 @@ DocRecord *Connection::get_doc_by_id(DocID id)
   try {
     // Retrieve document metadata.
 
-    string query1 =
-      string("SELECT doc_type, holding, status "
-             "FROM documents WHERE id='") +
-      string(id) + "';";
-
-    char **rows;
-    int nrow, ncol;
-    char *errmsg;
-    int res = sqlite3_get_table(_priv->dbconn, query1.c_str(),
-                                &rows, &nrow, &ncol, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Query failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+    {
+      Statement query(_priv, "SELECT doc_type, holding, status "
+                      "FROM documents WHERE id=?;");
+      query.bind(1, id);
+      if (!query.step())
+        throw Exception(Exception::DOCID_NOT_FOUND,
+                        string("Document ID '") + string(id) + "' not found");
+
+      if (query.columns() != 3)
+        throw Exception(Exception::DB_ERROR,
+                        "Internal DB error: bad result size!");
+
+      DocType doc_type(*this, query.text(0));
+      Holding holding(query.text(1));
+      Status status(query.text(2));
+
+      doc = new DocRecord(*this, doc_type, id);
+      doc->set_holding(holding);
+      doc->set_status(status);
     }
 
-    if (nrow != 1)
-      throw Exception(Exception::DOCID_NOT_FOUND,
-                      string("Document ID '") + string(id) + "' not found");
-
-    if (ncol != 3)
-      throw Exception(Exception::DB_ERROR,
-                      "Internal DB error: bad result size!");
-
-    DocType doc_type(*this, rows[3]);
-    Holding holding(rows[4]);
-    Status status(rows[5]);
-
-    doc = new DocRecord(*this, doc_type, id);
-    doc->set_holding(holding);
-    doc->set_status(status);
-
-    sqlite3_free_table(rows);
-
 
-    string query2 =
-      string("SELECT field_id, data FROM doc_data WHERE doc_id='") +
-      string(id) + "';";
-    res = sqlite3_get_table(_priv->dbconn, query2.c_str(),
-                            &rows, &nrow, &ncol, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Query failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+    Statement query(_priv, "SELECT field_id, data FROM doc_data "
+                    "WHERE doc_id=?;");
+    query.bind(1, id);
+    int nrow = 0;
+    while (query.step()) {
+      FieldType ftype(*this, query.text(0));
+      doc->set_field(ftype, query.text(1));
+      ++nrow;
     }
 
-    if (nrow < 1 || ncol != 2)
+    if (nrow < 1)
       throw Exception(Exception::DB_ERROR,
                       "Internal DB error: bad result size!");
-
-    for (int field = 0; field < nrow; ++field) {
-      FieldType ftype(*this, rows[2 * (field + 1) + 0]);
-      doc->set_field(ftype, rows[2 * (field + 1) + 1]);
-    }
-
-    sqlite3_free_table(rows);
   } catch (Exception &exc) {
     delete doc;
-    if (exc.type() == Exception::INVALID_DOCTYPE)
-      throw Exception(Exception::DB_ERROR,
-                      "Unrecognised document type in database!");
-    if (exc.type() == Exception::INVALID_FIELDTYPE)
-      throw Exception(Exception::DB_ERROR,
-                      "Unrecognised field type in database!");
-    else if (exc.type() == Exception::INVALID_HOLDING)
-      throw Exception(Exception::DB_ERROR,
-                      "Invalid holding value in database!");
-    else if (exc.type() == Exception::INVALID_STATUS)
-      throw Exception(Exception::DB_ERROR,
-                      "Invalid status value in database!");
-    else if (exc.type() == Exception::INVALID_DATE)
-      throw Exception(Exception::DB_ERROR,
-                      "Invalid creation date value in database!");
-    else
-      throw;
+    rethrow_record_error(exc);
   }
 
   doc->clear_modified();
@@ -1235,102 +1671,407 @@ DocRecord *Connection::get_doc_by_id(DocID id)
 }
 
 
-void Connection::delete_doc(DocID id)
+void Connection::get_docs_by_ids(const vector<DocID> &ids,
+                                 vector<DocRecord *> &docs)
 {
-  vector<DocID> deleted_ids;
-  get_deleted_ids(deleted_ids);
-  bool found = false;
-  for (int idx = 0; idx < deleted_ids.size(); ++idx)
-    if (deleted_ids[idx] == id) { found = true; break; }
-  if (!found) {
-    char *errmsg;
-    string cmd = "INSERT INTO deleted_ids VALUES ('" + string(id) + "');";
-    int res = sqlite3_exec(_priv->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+  docs.clear();
+  if (ids.size() == 0) return;
+
+  // All the requested documents are retrieved by a single query
+  // joining the document metadata to the field data.  The rows for
+  // each document come out together, so each record can be filled in
+  // as we go.
+
+  string query = "SELECT d.id, d.doc_type, d.holding, d.status, "
+    "f.field_id, f.data FROM documents d "
+    "LEFT JOIN doc_data f ON f.doc_id = d.id WHERE d.id IN (";
+  for (int idx = 0; idx < ids.size(); ++idx) {
+    if (idx != 0) query += ", ";
+    char buff[16];
+    sprintf(buff, "%d", static_cast<int>(ids[idx]));
+    query += buff;
+  }
+  query += ") ORDER BY d.id;";
+
+  map<DocID, DocRecord *> found;
+  try {
+    Statement stmt(_priv, query);
+    DocRecord *doc = 0;
+    while (stmt.step()) {
+      DocID id(stmt.integer(0));
+      if (!doc || doc->id() != id) {
+        doc = new DocRecord(*this, DocType(*this, stmt.text(1)), id);
+        found[id] = doc;
+        doc->set_holding(Holding(stmt.text(2)));
+        doc->set_status(Status(stmt.text(3)));
+      }
+      if (!stmt.null(4))
+        doc->set_field(FieldType(*this, stmt.text(4)), stmt.text(5));
     }
+
+    // Hand the records back in the order they were asked for.  The
+    // same ID may appear more than once, but each entry in the result
+    // must be a separate record, since the caller owns them all.
+
+    for (int idx = 0; idx < ids.size(); ++idx) {
+      map<DocID, DocRecord *>::iterator it = found.find(ids[idx]);
+      if (it == found.end())
+        throw Exception(Exception::DOCID_NOT_FOUND,
+                        string("Document ID '") + string(ids[idx]) +
+                        "' not found");
+      if (it->second) {
+        docs.push_back(it->second);
+        it->second = 0;
+      } else {
+        DocRecord *first = 0;
+        for (int prev = 0; prev < idx; ++prev)
+          if (ids[prev] == ids[idx]) { first = docs[prev];  break; }
+        docs.push_back(new DocRecord(*first));
+      }
+      docs.back()->clear_modified();
+    }
+  } catch (Exception &exc) {
+    for (map<DocID, DocRecord *>::iterator it = found.begin();
+         it != found.end(); ++it)
+      delete it->second;
+    for (int idx = 0; idx < docs.size(); ++idx)
+      delete docs[idx];
+    docs.clear();
+    rethrow_record_error(exc);
   }
 }
 
 
+void Connection::delete_doc(DocID id)
+{
+  if (!id.valid())
+    throw Exception(Exception::INVALID_DOCID, "Invalid document ID");
+  modified();
+  Statement cmd(_priv, "INSERT OR IGNORE INTO deleted_ids VALUES (?);");
+  cmd.bind(1, id);
+  cmd.exec();
+  _deleted[id] = true;
+  if (_store) _store->set_deleted(id, true);
+}
+
+
 void Connection::undelete_doc(DocID id)
 {
-  vector<DocID> deleted_ids;
-  get_deleted_ids(deleted_ids);
-  bool found = false;
-  for (int idx = 0; idx < deleted_ids.size(); ++idx)
-    if (deleted_ids[idx] == id) { found = true; break; }
-  if (found) {
-    char *errmsg;
-    string cmd = "DELETE FROM deleted_ids WHERE id='" + string(id) + "';";
-    int res = sqlite3_exec(_priv->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
-    }
-  }
+  if (!id.valid())
+    throw Exception(Exception::INVALID_DOCID, "Invalid document ID");
+  modified();
+  Statement cmd(_priv, "DELETE FROM deleted_ids WHERE id=?;");
+  cmd.bind(1, id);
+  cmd.exec();
+  _deleted[id] = false;
+  if (_store) _store->set_deleted(id, false);
 }
 
 
 void Connection::purge_deleted(void)
 {
+  modified();
   vector<DocID> deleted_ids;
-  get_deleted_ids(deleted_ids);
-  char *errmsg;
-  for (int idx = 0; idx < deleted_ids.size(); ++idx) {
-    string id = string(deleted_ids[idx]);
-    string cmd = "DELETE FROM doc_data WHERE doc_id='" + id + "';";
-    int res = sqlite3_exec(_priv->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
-    }
+  if (_store) get_deleted_ids(deleted_ids);
+
+  Transaction trans(_priv);
+  Statement del_data(_priv, "DELETE FROM doc_data WHERE doc_id IN "
+                     "(SELECT id FROM deleted_ids);");
+  del_data.exec();
+  if (sqlite3_changes(_priv->dbconn) > 0) _merging = true;
+  Statement del_docs(_priv, "DELETE FROM documents WHERE id IN "
+                     "(SELECT id FROM deleted_ids);");
+  del_docs.exec();
+  Statement cmd(_priv, "DELETE FROM deleted_ids;");
+  cmd.exec();
+  trans.commit();
+
+  if (_store)
+    for (int idx = 0; idx < deleted_ids.size(); ++idx)
+      _store->remove(deleted_ids[idx]);
+  _deleted.assign(_deleted.size(), false);
+}
+
 
-    cmd = "DELETE FROM documents WHERE id='" + id + "';";
-    res = sqlite3_exec(_priv->dbconn, cmd.c_str(), 0, 0, &errmsg);
-    if (res != SQLITE_OK) {
-      string excmsg = string("Command failed: ") + errmsg;
-      sqlite3_free(errmsg);
-      throw Exception(Exception::DB_ERROR, excmsg);
+// Deleting documents only adds to the full-text index, which has to
+// be merged to get rid of their entries, a slice at a time like the
+// vacuum.  A new connection can't tell whether an earlier one left a
+// merge unfinished, so it starts out assuming so, and the first merge
+// step finds out.  Small free lists are left alone, since SQLite
+// reuses free pages before growing the file, and databases not in
+// incremental auto-vacuum mode can't be vacuumed a step at a time.
+
+bool Connection::vacuum_pending(void)
+{
+  if (_vacuum_failed) return false;
+  if (_merging) return true;
+  Statement mode(_priv, "PRAGMA auto_vacuum;");
+  if (!mode.step() || mode.integer(0) != 2) return false;
+  Statement count(_priv, "PRAGMA freelist_count;");
+  int free_pages = count.step() ? count.integer(0) : 0;
+  if (free_pages >= VACUUM_MIN_FREE_PAGES)
+    _vacuuming = true;
+  else if (free_pages == 0)
+    _vacuuming = false;
+  return _vacuuming;
+}
+
+// FTS5 makes fewer than two changes to its tables once there's
+// nothing left to merge.  Steps are background work, so they don't
+// wait for other writers: if the database is locked, the step is just
+// skipped, to be tried again later.  Any other error would most
+// likely happen again on every step, so it ends vacuuming for this
+// connection.
+
+void Connection::vacuum_step(void)
+{
+  char buff[80];
+  sqlite3_busy_timeout(_priv->dbconn, 0);
+  try {
+    if (_merging) {
+      int changes = sqlite3_total_changes(_priv->dbconn);
+      sprintf(buff, "INSERT INTO doc_text (doc_text, rank) "
+              "VALUES ('merge', -%d);", VACUUM_STEP_PAGES);
+      Statement(_priv, string(buff)).exec();
+      if (sqlite3_total_changes(_priv->dbconn) - changes < 2)
+        _merging = false;
+    } else {
+      sprintf(buff, "PRAGMA incremental_vacuum(%d);", VACUUM_STEP_PAGES);
+      Statement cmd(_priv, string(buff));
+      while (cmd.step()) ;
     }
+  } catch (Exception &exc) {
+    int code = sqlite3_errcode(_priv->dbconn);
+    sqlite3_busy_timeout(_priv->dbconn, BUSY_TIMEOUT);
+    if (exc.type() == Exception::DB_ERROR &&
+        (code == SQLITE_BUSY || code == SQLITE_LOCKED))
+      return;
+    _merging = _vacuuming = false;
+    _vacuum_failed = true;
+    throw;
   }
+  sqlite3_busy_timeout(_priv->dbconn, BUSY_TIMEOUT);
+}
 
-  string cmd = "DELETE FROM deleted_ids;";
-  int res = sqlite3_exec(_priv->dbconn, cmd.c_str(), 0, 0, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Command failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+
+string Connection::journal_abbrev(string full_name)
+{
+  string abbrev;
+  return journals()->find(full_name, abbrev) ? abbrev : full_name;
+}
+
+
+JournalIndex *Connection::journals(void)
+{
+  if (!_journals) {
+    _journals = new JournalIndex();
+    _journals->load(_priv);
   }
+  return _journals;
 }
 
 
-string Connection::journal_abbrev(string full_name)
+// Intern a batch of new documents.  A contiguous block of IDs is
+// reserved for the whole batch and all the document and field rows
+// are inserted inside a single transaction, so either every document
+// is interned or (if anything fails) none of them is.
+
+void Connection::intern_docs(vector<DocRecord *> &docs)
 {
-  string retval = full_name;
-
-  char **rows;
-  int nrow, ncol;
-  char *errmsg;
-  string query = "SELECT abbrev_title FROM journal_abbrevs WHERE full_title='";
-  query += escape_string(full_name) + "';";
-  int res = sqlite3_get_table(_priv->dbconn, query.c_str(),
-                              &rows, &nrow, &ncol, &errmsg);
-  if (res != SQLITE_OK) {
-    string excmsg = string("Query failed: ") + errmsg;
-    sqlite3_free(errmsg);
-    throw Exception(Exception::DB_ERROR, excmsg);
+  for (int idx = 0; idx < docs.size(); ++idx)
+    if (docs[idx]->interned())
+      throw Exception(Exception::SEQUENCE,
+                      string("Document '") + string(docs[idx]->id()) +
+                      "' is already interned");
+  if (docs.size() == 0) return;
+
+  modified();
+  Transaction trans(_priv);
+
+  // Reserve IDs.
+
+  int first_id;
+  {
+    Statement query(_priv, "SELECT next_value FROM doc_id;");
+    if (!query.step() || query.columns() != 1)
+      throw Exception(Exception::DB_ERROR,
+                      "Internal DB error: bad result size!");
+    first_id = DocID(query.integer(0));
+  }
+  DocID next_id(first_id + static_cast<int>(docs.size()));
+  Statement set_next(_priv, "UPDATE doc_id SET next_value=?;");
+  set_next.bind(1, next_id);
+  set_next.exec();
+
+
+  // Insert document entries and fields.
+
+  Statement ins_doc(_priv, "INSERT INTO documents VALUES (?, ?, ?, ?);");
+  Statement ins_field(_priv, "INSERT INTO doc_data VALUES (?, ?, ?);");
+  for (int idx = 0; idx < docs.size(); ++idx) {
+    DocRecord *doc = docs[idx];
+    DocID new_id(first_id + idx);
+    ins_doc.bind(1, new_id);
+    ins_doc.bind(2, doc->_type);
+    ins_doc.bind(3, doc->_holding);
+    ins_doc.bind(4, doc->_status);
+    ins_doc.exec();
+
+    for (DocFields::const_iterator it = doc->_fields.begin();
+         it != doc->_fields.end(); ++it) {
+      if (it->second == "") continue;
+      ins_field.bind(1, new_id);
+      ins_field.bind(2, it->first);
+      ins_field.bind(3, it->second);
+      ins_field.exec();
+    }
+  }
+
+  trans.commit();
+
+  for (int idx = 0; idx < docs.size(); ++idx) {
+    docs[idx]->_id = DocID(first_id + idx);
+    docs[idx]->clear_modified();
+    if (_store) _store->put(*docs[idx]);
   }
+}
 
-  if (nrow > 0) retval = rows[1];
 
-  sqlite3_free_table(rows);
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: ConnectionPriv, Statement, Transaction
+//
+//----------------------------------------------------------------------
 
-  return retval;
+ConnectionPriv::~ConnectionPriv()
+{
+  delete readers;
+  for (map<string, sqlite3_stmt *>::iterator it = stmts.begin();
+       it != stmts.end(); ++it)
+    sqlite3_finalize(it->second);
+  sqlite3_close(dbconn);
+}
+
+
+// Return the cached prepared statement for a given piece of SQL,
+// preparing it first if this is the first time it's been used.
+
+sqlite3_stmt *ConnectionPriv::statement(const char *sql)
+{
+  map<string, sqlite3_stmt *>::iterator it = stmts.find(sql);
+  if (it != stmts.end()) return it->second;
+
+  sqlite3_stmt *stmt;
+  int res = sqlite3_prepare_v2(dbconn, sql, -1, &stmt, 0);
+  if (res != SQLITE_OK)
+    throw Exception(Exception::DB_ERROR,
+                    string("Query failed: ") + sqlite3_errmsg(dbconn));
+  stmts[sql] = stmt;
+  return stmt;
+}
+
+
+Statement::Statement(ConnectionPriv *priv, const char *sql) :
+  _db(priv->dbconn), _stmt(priv->statement(sql)), _cached(true)
+{ }
+
+Statement::Statement(ConnectionPriv *priv, string sql) :
+  _db(priv->dbconn), _stmt(0), _cached(false)
+{
+  int res = sqlite3_prepare_v2(_db, sql.c_str(), -1, &_stmt, 0);
+  if (res != SQLITE_OK)
+    throw Exception(Exception::DB_ERROR,
+                    string("Query failed: ") + sqlite3_errmsg(_db));
+}
+
+Statement::~Statement()
+{
+  if (_cached) {
+    sqlite3_reset(_stmt);
+    sqlite3_clear_bindings(_stmt);
+  } else
+    sqlite3_finalize(_stmt);
+}
+
+void Statement::bind(int idx, string val)
+{
+  // A statement being rebound for another round of execution needs
+  // to be reset first.
+
+  sqlite3_reset(_stmt);
+  int res = sqlite3_bind_text(_stmt, idx, val.c_str(), val.size(),
+                              SQLITE_TRANSIENT);
+  if (res != SQLITE_OK)
+    throw Exception(Exception::DB_ERROR,
+                    string("Parameter binding failed: ") +
+                    sqlite3_errmsg(_db));
+}
+
+// Bind a NUL-terminated string, or NULL for a null pointer.
+
+void Statement::bind(int idx, const char *val)
+{
+  sqlite3_reset(_stmt);
+  int res = val ? sqlite3_bind_text(_stmt, idx, val, -1, SQLITE_TRANSIENT) :
+    sqlite3_bind_null(_stmt, idx);
+  if (res != SQLITE_OK)
+    throw Exception(Exception::DB_ERROR,
+                    string("Parameter binding failed: ") +
+                    sqlite3_errmsg(_db));
+}
+
+void Statement::bind(int idx, int val)
+{
+  sqlite3_reset(_stmt);
+  int res = sqlite3_bind_int(_stmt, idx, val);
+  if (res != SQLITE_OK)
+    throw Exception(Exception::DB_ERROR,
+                    string("Parameter binding failed: ") +
+                    sqlite3_errmsg(_db));
+}
+
+bool Statement::step(void)
+{
+  int res = sqlite3_step(_stmt);
+  if (res == SQLITE_ROW) return true;
+  if (res == SQLITE_DONE) return false;
+  string excmsg = sqlite3_stmt_readonly(_stmt) ?
+    "Query failed: " : "Command failed: ";
+  excmsg += sqlite3_errmsg(_db);
+  sqlite3_reset(_stmt);
+  throw Exception(Exception::DB_ERROR, excmsg);
+}
+
+string Statement::text(int col) const
+{
+  const unsigned char *val = sqlite3_column_text(_stmt, col);
+  if (!val) return "";
+  return string(reinterpret_cast<const char *>(val),
+                sqlite3_column_bytes(_stmt, col));
+}
+
+
+Transaction::Transaction(ConnectionPriv *priv) : _priv(priv), _active(false)
+{
+  if (sqlite3_get_autocommit(_priv->dbconn)) {
+    Statement cmd(_priv, "BEGIN IMMEDIATE;");
+    cmd.exec();
+    _active = true;
+  }
+}
+
+Transaction::~Transaction()
+{
+  if (_active) sqlite3_exec(_priv->dbconn, "ROLLBACK;", 0, 0, 0);
+}
+
+void Transaction::commit(void)
+{
+  if (_active) {
+    Statement cmd(_priv, "COMMIT;");
+    cmd.exec();
+    _active = false;
+  }
 }
 
 
@@ -1348,6 +2089,57 @@ static string escape_string(string in_str)
   return retval;
 }
 
+
+// Substring patterns can be looked up in the trigram full-text index
+// if they're at least one trigram long and don't contain any LIKE
+// wildcard characters.
+
+static bool text_indexable(string pattern)
+{
+  return pattern.size() >= 3 && pattern.find_first_of("%_") == string::npos;
+}
+
+
+// Quote a pattern as an FTS5 phrase.
+
+static string text_phrase(string pattern)
+{
+  string retval = "\"";
+  for (int idx = 0; idx < pattern.size(); ++idx) {
+    if (pattern[idx] == '"') retval += '"';
+    retval += pattern[idx];
+  }
+  retval += '"';
+  return retval;
+}
+
+
+// Errors in the contents of a database record are reported as
+// database errors, whatever the value that was found to be invalid.
+// This must be called from within a handler, since other exceptions
+// are simply rethrown.
+
+static void rethrow_record_error(Exception &exc)
+{
+  if (exc.type() == Exception::INVALID_DOCTYPE)
+    throw Exception(Exception::DB_ERROR,
+                    "Unrecognised document type in database!");
+  if (exc.type() == Exception::INVALID_FIELDTYPE)
+    throw Exception(Exception::DB_ERROR,
+                    "Unrecognised field type in database!");
+  else if (exc.type() == Exception::INVALID_HOLDING)
+    throw Exception(Exception::DB_ERROR,
+                    "Invalid holding value in database!");
+  else if (exc.type() == Exception::INVALID_STATUS)
+    throw Exception(Exception::DB_ERROR,
+                    "Invalid status value in database!");
+  else if (exc.type() == Exception::INVALID_DATE)
+    throw Exception(Exception::DB_ERROR,
+                    "Invalid creation date value in database!");
+  else
+    throw;
+}
+
 //----------------------------------------------------------------------
 //----------------------------------------------------------------------
 //----------------------------------------------------------------------
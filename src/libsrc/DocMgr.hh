@@ -22,7 +22,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <list>
+#include <bitset>
 
 using namespace std;
 
@@ -71,85 +73,161 @@ namespace DocMgr {
   };
 
 
-  // Field types.
+  // Field types.  A field type is an ordinal into the catalog of
+  // field types held by the connection, which is sorted by field ID,
+  // so field types compare in the same order as their IDs.
 
   class FieldType {
   public:
     friend class Connection;
 
-    FieldType() : _id(""), _name(""), _condition("") { }
+    FieldType() : _db(0), _ordinal(-1) { }
     FieldType(Connection &db, string poss_id);
-    FieldType(const FieldType &other) :
-      _id(other._id), _name(other._name), _condition(other._condition) { }
-    FieldType &operator=(const FieldType &other)
-    { _id = other._id;  _name = other._name;  _condition = other._condition;
-    return *this; }
 
-    bool valid(void) const { return _id != ""; }
+    bool valid(void) const { return _ordinal >= 0; }
     static bool valid(Connection &db, string poss_id);
 
-    bool operator==(const FieldType &other) const { return _id == other._id; }
-    bool operator!=(const FieldType &other) const { return _id != other._id; }
-    bool operator<(const FieldType &other) const { return _id < other._id; }
-    bool operator<=(const FieldType &other) const { return _id <= other._id; }
-    bool operator>(const FieldType &other) const { return _id > other._id; }
-    bool operator>=(const FieldType &other) const { return _id >= other._id; }
+    int ordinal(void) const { return _ordinal; }
+
+    bool operator==(const FieldType &other) const
+    { return _ordinal == other._ordinal; }
+    bool operator!=(const FieldType &other) const
+    { return _ordinal != other._ordinal; }
+    bool operator<(const FieldType &other) const
+    { return _ordinal < other._ordinal; }
+    bool operator<=(const FieldType &other) const
+    { return _ordinal <= other._ordinal; }
+    bool operator>(const FieldType &other) const
+    { return _ordinal > other._ordinal; }
+    bool operator>=(const FieldType &other) const
+    { return _ordinal >= other._ordinal; }
 
-    operator string(void) const { return _id; }
+    operator string(void) const;
 
     string id(void) const;
     string name(void) const;
     string condition(void) const;
 
+    // Position in the compile-time catalog (see Catalog.hh), or -1 if
+    // the catalog doesn't have a matching entry.
+    int catalog(void) const;
+
   private:
 
-    FieldType(string id, string name, string condition) :
-      _id(id), _name(name), _condition(condition) { }
+    FieldType(const Connection *db, int ordinal) :
+      _db(db), _ordinal(ordinal) { }
 
-    string _id;
-    string _name;
-    string _condition;
+    const Connection *_db;
+    int _ordinal;
   };
 
 
-  // Document types.
+  // Document types, as ordinals into the connection's catalog of
+  // document types, in the order they're listed in the database.
 
   class DocType {
   public:
     friend class Connection;
 
-    DocType() : _id(""), _name(""), _mandatory("") { }
+    DocType() : _db(0), _ordinal(-1) { }
     DocType(Connection &db, string poss_id);
-    DocType(const DocType &other) :
-      _id(other._id), _name(other._name), _mandatory(other._mandatory) { }
-    DocType &operator=(const DocType &other)
-    { _id = other._id;  _name = other._name;  _mandatory = other._mandatory;
-    return *this; }
-
-    bool operator==(const DocType &other) const { return _id == other._id; }
-    bool operator!=(const DocType &other) const { return _id != other._id; }
-    bool operator<(const DocType &other) const { return _id < other._id; }
-    bool operator<=(const DocType &other) const { return _id <= other._id; }
-    bool operator>(const DocType &other) const { return _id > other._id; }
-    bool operator>=(const DocType &other) const { return _id >= other._id; }
-
-    bool valid(void) const { return _id != ""; }
+
+    bool operator==(const DocType &other) const
+    { return _ordinal == other._ordinal; }
+    bool operator!=(const DocType &other) const
+    { return _ordinal != other._ordinal; }
+    bool operator<(const DocType &other) const
+    { return _ordinal < other._ordinal; }
+    bool operator<=(const DocType &other) const
+    { return _ordinal <= other._ordinal; }
+    bool operator>(const DocType &other) const
+    { return _ordinal > other._ordinal; }
+    bool operator>=(const DocType &other) const
+    { return _ordinal >= other._ordinal; }
+
+    bool valid(void) const { return _ordinal >= 0; }
     static bool valid(Connection &db, string poss_id);
 
-    operator string(void) const { return _id; }
+    int ordinal(void) const { return _ordinal; }
+
+    operator string(void) const;
 
     string id(void) const;
     string name(void) const;
     string mandatory(void) const;
+    int catalog(void) const;
 
   private:
 
-    DocType(string id, string name, string mandatory) :
-      _id(id), _name(name), _mandatory(mandatory) { }
+    DocType(const Connection *db, int ordinal) :
+      _db(db), _ordinal(ordinal) { }
 
-    string _id;
-    string _name;
-    string _mandatory;
+    const Connection *_db;
+    int _ordinal;
+  };
+
+
+  // Field values of a document, held in an array indexed by field
+  // type ordinal.  This behaves like a map<FieldType, string>:
+  // looking up a field with [] adds it to the document, and iteration
+  // visits the fields that have been added, in field ID order.
+
+  class DocFields {
+  public:
+
+    typedef pair<FieldType, string> value_type;
+
+    template <class Container, class Value> class basic_iterator {
+    public:
+      basic_iterator() : _fields(0), _idx(0) { }
+      basic_iterator(Container *fields, int idx) :
+        _fields(fields), _idx(idx) { skip(); }
+      template <class C, class V>
+      basic_iterator(const basic_iterator<C, V> &other) :
+        _fields(other._fields), _idx(other._idx) { }
+
+      Value &operator*(void) const { return _fields->_slots[_idx]; }
+      Value *operator->(void) const { return &_fields->_slots[_idx]; }
+      basic_iterator &operator++(void) { ++_idx;  skip();  return *this; }
+      basic_iterator operator++(int)
+      { basic_iterator retval = *this;  ++*this;  return retval; }
+      bool operator==(const basic_iterator &other) const
+      { return _idx == other._idx; }
+      bool operator!=(const basic_iterator &other) const
+      { return _idx != other._idx; }
+
+    private:
+      template <class C, class V> friend class basic_iterator;
+
+      void skip(void)
+      { while (_idx < _fields->_slots.size() && !_fields->_present[_idx])
+          ++_idx; }
+
+      Container *_fields;
+      int _idx;
+    };
+
+    typedef basic_iterator<DocFields, value_type> iterator;
+    typedef basic_iterator<const DocFields, const value_type> const_iterator;
+
+    DocFields(const Connection &db);
+
+    string &operator[](FieldType field);
+    iterator find(FieldType field);
+    const_iterator find(FieldType field) const;
+
+    iterator begin(void) { return iterator(this, 0); }
+    iterator end(void) { return iterator(this, _slots.size()); }
+    const_iterator begin(void) const { return const_iterator(this, 0); }
+    const_iterator end(void) const
+    { return const_iterator(this, _slots.size()); }
+
+  private:
+
+    int slot(FieldType field) const;
+
+    vector<value_type> _slots;
+    vector<char> _present;
   };
 
 
@@ -218,7 +296,8 @@ namespace DocMgr {
                    INVALID_HOLDING, INVALID_STATUS,
                    INVALID_DOCID, INVALID_DATE,
                    INVALID_FIELDTYPE, INVALID_DOCTYPE, INVALID_QUERY,
-                   DOCID_NOT_FOUND, SEQUENCE, DB_ERROR };
+                   DOCID_NOT_FOUND, SEQUENCE, DB_ERROR,
+                   QUERY_CANCELLED };
 
     Exception(string msg) : _type(MISC), _msg(msg) { }
     Exception(ExcType type, string msg) : _type(type), _msg(msg) { }
@@ -247,7 +326,9 @@ namespace DocMgr {
     DocID id(void) const { return _id; }
     Holding holding(void) const { return _holding; }
     Status status(void) const { return _status; }
-    map<FieldType, string> &fields(void) { return _fields; }
+    DocFields &fields(void) { return _fields; }
+    const DocFields &fields(void) const { return _fields; }
+    string field(FieldType field_id) const;
 
     void set_holding(Holding holding);
     void set_status(Status status);
@@ -269,23 +350,31 @@ namespace DocMgr {
   private:
 
     DocRecord(Connection &db, DocType type, DocID id);
-    void clear_modified(void) { _modified = false; }
-
-    bool mandatory_check(string mandatory, list<FieldType> &bad_field_types);
+    void clear_modified(void);
 
     Connection &_db;
     DocType _type;
     DocID _id;
     Holding _holding;
     Status _status;
-    map<FieldType, string> _fields;
+    DocFields _fields;
     bool _modified;
+
+    // Values as last read from or written to the database, which
+    // update() compares against to find what has changed.  Fields are
+    // indexed by ordinal.
+    Holding _saved_holding;
+    Status _saved_status;
+    vector<string> _saved_fields;
   };
 
 
   // Database queries.
 
   class Connection;
+  class QueryJob;
+  struct DocStore;
+  class DocSet;
   class Query {
   public:
 
@@ -303,9 +392,14 @@ namespace DocMgr {
 
     operator string(void) const;
     void run(vector<DocID> &ids);
+    int count(void) const;
+    bool contains(DocID id) const;
+    QueryJob *run_async(void) const;
 
   private:
 
+    friend class QueryCursor;
+
     typedef pair<FieldType, string> QClause;
     enum QType { EMPTY, QUICK, SIMPLE, HOLDING, STATUS, AND, OR };
 
@@ -321,55 +415,312 @@ namespace DocMgr {
 
     static void delete_tree(QTreeNode *orig);
     static QTreeNode *copy_tree(QTreeNode *orig);
-    static string process_tree(QTreeNode *node);
+    static string process_tree(QTreeNode *node, bool filter);
+    static string match_set(QTreeNode *node);
+    static double selectivity(QTreeNode *node);
+    static bool more_selective(QTreeNode *a, QTreeNode *b);
+    static void and_terms(QTreeNode *node, vector<QTreeNode *> &terms);
+    string sql(string cond) const;
+    void evaluate(const DocStore &store, DocSet &result) const;
+    static void evaluate(const DocStore &store, QTreeNode *node,
+                         DocSet &result);
 
     Connection *_db;
     QTreeNode *_tree;
   };
 
 
+  // Incremental access to query results, one document at a time, in
+  // document ID order.  Nothing is read from the database until it is
+  // asked for, so callers that only want the first few results can
+  // stop early.
+
+  class Statement;
+  class QueryCursor {
+  public:
+
+    QueryCursor(const Query &query);
+    ~QueryCursor();
+
+    bool next(DocID &id);
+    DocRecord *next_doc(void);
+
+  private:
+
+    friend class Query;
+
+    QueryCursor(Connection &db, string sql);
+    QueryCursor(const QueryCursor &other);
+    QueryCursor &operator=(const QueryCursor &other);
+
+    Connection &_db;
+    Statement *_stmt;
+    bool _done;
+  };
+
+
+  // Handle for a query running in the background, on a worker thread
+  // with its own read-only connection to the database.  Deleting the
+  // handle cancels the query if it's still running.
+
+  struct QueryJobPriv;
+  class QueryJob {
+  public:
+
+    ~QueryJob();
+
+    bool done(void) const;
+    bool cancelled(void) const;
+    void cancel(void);
+    void wait(void);
+    const vector<DocID> &results(void);
+
+  private:
+
+    friend class Query;
+    friend class Connection;
+
+    QueryJob(Connection &db, string query);
+    QueryJob(const QueryJob &other);
+    QueryJob &operator=(const QueryJob &other);
+
+    Connection &_db;
+    string _query;
+    unsigned long _generation;
+    bool _cached;
+    QueryJobPriv *_priv;
+  };
+
+
+  // Problem found by Connection::validate.  The document ID is kept
+  // as a plain integer, since orphaned field data may carry an ID
+  // that isn't valid.
+
+  struct Violation {
+    enum Kind { MISSING_FIELDS, UNKNOWN_DOCTYPE, UNKNOWN_FIELD,
+                UNEXPECTED_FIELD, DANGLING_XREF, ORPHANED_DATA };
+
+    Violation(Kind kind, int doc_id, string detail) :
+      kind(kind), doc_id(doc_id), detail(detail) { }
+    bool operator<(const Violation &other) const
+    { return doc_id < other.doc_id ||
+        (doc_id == other.doc_id && kind < other.kind); }
+
+    Kind kind;
+    int doc_id;
+    string detail;
+  };
+
+
   // Database connection.
 
+  struct JournalIndex;
+  struct CatalogRow;
+
   struct ConnectionPriv;
   class Connection {
   public:
 
+    friend class FieldType;
+    friend class DocType;
+    friend class DocFields;
     friend class DocRecord;
-
-    Connection(string dbfile);
+    friend class Query;
+    friend class QueryCursor;
+    friend class QueryJob;
+    friend class BulkLoader;
+
+    // With the memory store enabled, all documents are loaded when
+    // the connection is opened, and queries are evaluated in memory.
+    // With catalog snapshots enabled, the document and field types
+    // are read from a file next to the database (written the first
+    // time round) as long as it was made for the current schema
+    // version.  Edit the catalog tables by hand only with the
+    // snapshot deleted.
+    Connection(string dbfile, bool memory_store = false,
+               bool catalog_snapshot = false);
     ~Connection();
 
+    int schema_version(void);
+    bool memory_store(void) const { return _store != 0; }
+
     DocID max_doc_id(void);
     DocRecord *get_doc_by_id(DocID id);
+    void get_docs_by_ids(const vector<DocID> &ids, vector<DocRecord *> &docs);
     void get_ids(string query, vector<DocID> &ids);
+    int count_ids(string query);
+    void count_queries(const vector<Query> &queries, vector<int> &counts);
     void get_deleted_ids(vector<DocID> &ids);
+    bool doc_deleted(DocID id) const;
 
     const vector<DocType> &doc_types(void) { return _doc_types; }
     const vector<FieldType> &field_types(void) { return _field_types; }
-    const vector<FieldType> &doc_fields(DocType doc_type)
-    { return _doc_fields[doc_type]; }
+    const vector<FieldType> &doc_fields(DocType doc_type);
 
     bool view_deleted(void) const { return _view_deleted; }
     void set_view_deleted(bool view_deleted) { _view_deleted = view_deleted; }
 
+    void intern_docs(vector<DocRecord *> &docs);
+
     void delete_doc(DocID id);
     void undelete_doc(DocID id);
 
+    // Deleted documents are removed in a single transaction.  The
+    // space they took up goes on the database's free list, and is
+    // handed back to the file system by vacuum_step, which
+    // applications should call when they're idle for as long as
+    // vacuum_pending returns true.  A step that finds the database
+    // locked by another writer does nothing; any other failure is
+    // thrown, and stops vacuuming through this connection.
     void purge_deleted(void);
+    bool vacuum_pending(void);
+    void vacuum_step(void);
 
+    // Abbreviations are looked up in memory, and titles that don't
+    // quite match any in the table are matched approximately.  The
+    // abbreviation table is read once per connection.
     string journal_abbrev(string full_name);
 
+    // Check every document in the database against the schema: the
+    // mandatory fields of its type, its field types and any
+    // cross-reference.  Documents are checked in parallel, using the
+    // pool of read-only connections.
+    void validate(vector<Violation> &violations);
+
+    // Copy the database to a new SQLite file, a slice of pages at a
+    // time, from a snapshot taken when the backup starts.  Writes
+    // through this or any other connection carry on while it runs.
+    // The static version backs up a database without opening a
+    // connection to it, so without any schema migration first.
+    void backup(string dest_file);
+    static void backup(string dbfile, string dest_file);
+
+    // Query results are cached until the next change to the
+    // documents, through this connection or any other.
+    unsigned long write_generation(void);
+    int cache_hits(void) const { return _cache_hits; }
+    int cache_misses(void) const { return _cache_misses; }
+    void clear_query_cache(void) { _query_cache.clear(); }
+
   private:
 
     ConnectionPriv *priv(void) const { return _priv; }
+    DocStore *store(void);
+    JournalIndex *journals(void);
+    void modified(void) { ++_generation; }
+    void cache_ids(string query, unsigned long generation,
+                   const vector<DocID> &ids);
+
+    // Set of field types, indexed by ordinal.
+    typedef bitset<128> FieldMask;
+
+    // Mandatory field rule for a document type, compiled from the
+    // S-expression in doc_types.mandatory, e.g. "(AND (OR AU ED) TI)".
+    // The rule holds if all of the fields in the mask are present
+    // along with all of the nested clauses, or, for an OR rule, any
+    // one of them.  The terms list the fields (clause -1) and clauses
+    // in the order they're written, for reporting missing fields.
+    struct MandatoryRule {
+      MandatoryRule() : any(false) { }
+      bool holds(const FieldMask &present) const;
+      void missing(const FieldMask &present,
+                   list<FieldType> &bad_field_types) const;
+      bool any;
+      FieldMask mask;
+      vector<MandatoryRule> clauses;
+      vector<pair<FieldType, int> > terms;
+    };
+
+    struct DocTypeInfo {
+      string id, name, mandatory;
+      vector<FieldType> fields;
+      MandatoryRule rule;
+      FieldMask allowed;
+      int catalog;
+    };
+
+    struct FieldTypeInfo {
+      string id, name, condition;
+      int catalog;
+    };
+
+    struct CachedResult {
+      unsigned long generation;
+      bool have_ids;
+      vector<DocID> ids;
+      int count;
+    };
+
+    typedef unordered_map<string, int> OrdinalMap;
+
+    void load_catalog(const vector<CatalogRow> &rows);
+    void load_deleted(void);
+    void compile_rule(const string &expr, string::size_type &pos,
+                      MandatoryRule &rule);
+    bool mandatory_ok(DocType type, const FieldMask &present,
+                      list<FieldType> &bad_field_types) const;
+    void validate_range(int first, int last, const vector<bool> &exists,
+                        vector<Violation> &violations, string &error) const;
 
     ConnectionPriv *_priv;
     vector<DocType> _doc_types;
     vector<FieldType> _field_types;
-    map<DocType, vector<FieldType> > _doc_fields;
+    vector<DocTypeInfo> _doc_info;
+    vector<FieldTypeInfo> _field_info;
+    OrdinalMap _doc_ordinals, _field_ordinals;
+    vector<bool> _deleted;
     bool _view_deleted;
+    map<string, CachedResult> _query_cache;
+    unsigned long _generation;
+    int _data_version;
+    int _cache_hits, _cache_misses;
+    DocStore *_store;
+    JournalIndex *_journals;
+
+    // Set by purge_deleted (and when the connection is opened) until
+    // the full-text index has been merged down, dropping the entries
+    // of purged documents, and once the free list is big enough to
+    // start vacuuming until it's empty again.
+    bool _merging, _vacuuming;
+
+    // Set once a vacuum step has failed other than by finding the
+    // database locked.
+    bool _vacuum_failed;
+  };
+
+  // Bulk loading of raw table rows, for restoring backups and loading
+  // the journal abbreviations.  Rows are inserted (replacing any with
+  // the same key) through one prepared statement per table, and the
+  // whole load is a single transaction, which is rolled back if the
+  // loader is deleted before it's committed.  Loading documents or
+  // field data suspends the full-text and secondary indexes, which are
+  // rebuilt by commit().  Loading document or field types reloads the
+  // connection's catalog, so DocType and FieldType values (and records)
+  // from before the load shouldn't be used after it.
+
+  struct BulkLoaderPriv;
+  class BulkLoader {
+  public:
+
+    BulkLoader(Connection &db);
+    ~BulkLoader();
+
+    // Start loading rows into a table, optionally emptying it first.
+    void table(string name, bool replace);
+
+    // Add a row to the current table.  Null pointers are NULLs.
+    void add(const vector<const char *> &values);
+
+    void commit(void);
+    int rows(void) const;
+
+  private:
+
+    Connection &_db;
+    BulkLoaderPriv *_priv;
   };
 
+
   inline ostream &operator<<(ostream &ostr, const DocRecord &doc)
   {
     doc.display(ostr);
@@ -0,0 +1,439 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   DocMgrPriv.hh
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Private header file for document manager library: definitions
+//  shared between library source files but not visible to clients.
+//
+//----------------------------------------------------------------------
+
+#ifndef _H_DOCMGRPRIV_
+#define _H_DOCMGRPRIV_
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+
+// Sqlite3 API header.
+
+#include <sqlite3.h>
+
+
+// Local header.
+
+#include "DocMgr.hh"
+
+
+//----------------------------------------------------------------------
+//
+//  CONSTANT DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+namespace DocMgr {
+
+  // Schema version that this version of the library works with.
+  // Older databases are brought up to date when they are opened.
+
+  const int CURRENT_SCHEMA_VERSION = 3;
+
+  // Maximum number of query results held by each connection.
+
+  const int QUERY_CACHE_SIZE = 64;
+
+  // Time (in ms) to wait for another connection to release a lock on
+  // the database.
+
+  const int BUSY_TIMEOUT = 5000;
+
+  // Maximum number of read-only connections each connection keeps
+  // for running queries in the background.
+
+  const int MAX_READERS = 4;
+
+  // Number of database pages copied by each step of an online backup,
+  // and the pause (in ms) between steps.
+
+  const int BACKUP_STEP_PAGES = 256;
+  const int BACKUP_STEP_PAUSE = 5;
+
+  // Suffix added to the database file name for the catalog snapshot.
+
+  const char *const CATALOG_SNAPSHOT_SUFFIX = "-catalog";
+
+  // Free pages that make it worth starting an incremental vacuum, and
+  // the number of pages handed back by each step of one.
+
+  const int VACUUM_MIN_FREE_PAGES = 256;
+  const int VACUUM_STEP_PAGES = 256;
+
+  // Number of possible document IDs.
+
+  const int MAX_DOC_IDS = 1000000;
+
+  // Largest posting list chunk held as an array of document indexes;
+  // bigger chunks are held as bitmaps.
+
+  const int POSTING_ARRAY_MAX = 4096;
+
+
+//----------------------------------------------------------------------
+//
+//  CLASS DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+  // Private connection data.
+
+  struct ReaderPool;
+  struct ConnectionPriv {
+    ConnectionPriv() : dbconn(0), readers(0) { }
+    ~ConnectionPriv();
+
+    sqlite3_stmt *statement(const char *sql);
+
+    sqlite3 *dbconn;
+    string dbfile;
+    map<string, sqlite3_stmt *> stmts;
+    ReaderPool *readers;
+  };
+
+
+  // Pool of read-only connections to a database, shared between
+  // threads.  Connections are opened as they're needed, up to a
+  // fixed number, after which threads wait for one to be released.
+  // With the database in WAL mode, readers don't block each other or
+  // the writer.
+
+  struct ReaderPool {
+    ReaderPool(string dbfile, int size) :
+      dbfile(dbfile), size(size), opened(0) { }
+    ~ReaderPool();
+
+    ConnectionPriv *acquire(void);
+    void release(ConnectionPriv *conn);
+
+    string dbfile;
+    int size;
+
+    mutex lock;
+    condition_variable available;
+    int opened;
+    vector<ConnectionPriv *> idle;
+  };
+
+
+  // Background query data.  The worker thread borrows a read-only
+  // connection from the pool, which nothing else touches while the
+  // query is running apart from calls to sqlite3_interrupt to cancel
+  // it.  Everything below the mutex is shared with the worker and
+  // protected by it.
+
+  struct QueryJobPriv {
+    QueryJobPriv(ReaderPool *pool, string sql);
+    ~QueryJobPriv();
+
+    void run(void);
+
+    ReaderPool *pool;
+    string sql;
+    thread worker;
+
+    mutex lock;
+    condition_variable finished;
+    ConnectionPriv *conn;
+    bool done, cancelled;
+    string error;
+    vector<DocID> ids;
+  };
+
+
+  // Set of documents in the in-memory store, as one bit per document
+  // index.  Sets combined with each other should be the same size.
+
+  class DocSet {
+  public:
+
+    DocSet(int size = 0) : _size(size), _bits((size + 63) / 64, 0) { }
+
+    int size(void) const { return _size; }
+    void resize(int size);
+    void fill(void);
+    void add(int idx) { _bits[idx >> 6] |= 1ULL << (idx & 63); }
+    void remove(int idx) { _bits[idx >> 6] &= ~(1ULL << (idx & 63)); }
+    bool contains(int idx) const
+    { return idx >= 0 && idx < _size && (_bits[idx >> 6] >> (idx & 63)) & 1; }
+    int next(int idx) const;
+    int count(void) const;
+
+    DocSet &operator&=(const DocSet &other);
+    DocSet &operator|=(const DocSet &other);
+    DocSet &subtract(const DocSet &other);
+
+  private:
+
+    friend class Posting;
+
+    int _size;
+    vector<unsigned long long> _bits;
+  };
+
+
+  // Compressed set of document indexes, in the style of a roaring
+  // bitmap, used for the posting list of each indexed value in the
+  // memory store.  Indexes are split into chunks of 65536 by their
+  // high bits; each chunk is held as a sorted array of the low bits
+  // while it has few members, and as a bitmap once it fills up.  A
+  // posting list for a rare value costs two bytes per document, and
+  // one for a common value at most one bit per document.
+
+  class Posting {
+  public:
+
+    Posting() : _count(0) { }
+
+    int count(void) const { return _count; }
+    bool contains(int idx) const;
+    void add(int idx);
+    void remove(int idx);
+    void add_to(DocSet &set) const;
+
+  private:
+
+    struct Chunk {
+      int key;
+      int count;
+      vector<unsigned short> array;
+      vector<unsigned long long> bits;
+    };
+
+    Chunk *chunk(int key, bool create);
+    const Chunk *chunk(int key) const;
+
+    vector<Chunk> _chunks;
+    int _count;
+  };
+
+
+  // In-memory copy of the documents and their field data, for
+  // connections opened with the memory store enabled.  Each document
+  // is given a small integer index when it's loaded, and each field
+  // is held as a column of interned value numbers, one per document
+  // index, so that a query term is evaluated by matching the distinct
+  // values once and then scanning an integer array.  For substring
+  // searches, the distinct values of each column are also kept in
+  // lower case in a single buffer, separated by NULs.  Columns that
+  // are only ever matched exactly (status, holding and fields with
+  // an "=" condition) also keep a posting list for each value, so
+  // that those terms need no scan at all.
+
+  struct DocStore {
+    struct Column {
+      Column(bool indexed = false) : indexed(indexed) { }
+
+      void set(int idx, const string &val);
+      void find(const string &val, DocSet &result) const;
+      void search(const vector<string> &patterns, DocSet &result) const;
+
+      vector<int> values;
+      unordered_map<string, int> numbers;
+      string text;
+      vector<int> offsets;
+      bool indexed;
+      vector<Posting> postings;
+    };
+
+    DocStore() : ordered(true), status(true), holding(true) { }
+
+    int size(void) const { return ids.size(); }
+    int index_of(DocID id) const { return index[static_cast<int>(id)]; }
+
+    void load(ConnectionPriv *priv);
+    void put(DocRecord &doc);
+    void remove(DocID id);
+    void set_deleted(DocID id, bool deleted);
+
+    void match_value(const string &field, const string &val,
+                     DocSet &result) const;
+    void match_text(const string &field, const vector<string> &patterns,
+                    DocSet &result) const;
+    void collect(const DocSet &set, vector<DocID> &result) const;
+
+    int add(DocID id);
+    Column &column(const string &field);
+
+    vector<DocID> ids;
+    vector<int> index;
+    bool ordered;
+    DocSet present, deleted;
+    Column status, holding;
+    map<string, Column> fields;
+    vector<string> exact_fields;
+  };
+
+
+  // Journal abbreviations, loaded from the journal_abbrevs table the
+  // first time one is needed.  Titles are looked up as given, then
+  // with case and punctuation folded, and then approximately, by
+  // edit distance against the titles that share enough of their
+  // three-letter substrings (trigrams) to be within reach.
+  // Approximate matches must agree on every word of one or two
+  // characters (so "PHYSICAL REVIEW B" never matches "PHYSICAL REVIEW
+  // D") and are only accepted if there is a single best match.  The
+  // results of approximate lookups are remembered, since an import
+  // usually has many articles from each journal.
+
+  struct JournalIndex {
+    JournalIndex() : indexed(false) { }
+
+    void load(ConnectionPriv *priv);
+    bool find(const string &full_name, string &abbrev);
+
+    static string fold(const string &title);
+    void index_trigrams(void);
+    int approximate(const string &key) const;
+
+    vector<string> abbrevs, keys;
+    unordered_map<string, int> exact, folded;
+    bool indexed;
+    unordered_map<int, vector<int> > trigrams;
+    unordered_map<string, int> approximations;
+  };
+
+
+  // Prepared statement wrapper.  Statements for fixed SQL text are
+  // prepared once and kept in the connection's statement cache; the
+  // wrapper resets the statement and clears its bindings when it goes
+  // out of scope, so a cached statement is always ready for reuse,
+  // even if an exception is thrown part-way through stepping it.
+  // One-off statements (e.g. SQL generated from queries) are
+  // finalized instead.
+
+  class Statement {
+  public:
+
+    Statement(ConnectionPriv *priv, const char *sql);
+    Statement(ConnectionPriv *priv, string sql);
+    ~Statement();
+
+    void bind(int idx, string val);
+    void bind(int idx, const char *val);
+    void bind(int idx, int val);
+    void bind(int idx, DocID val) { bind(idx, static_cast<int>(val)); }
+    bool step(void);
+    void exec(void) { while (step()) ; }
+
+    int columns(void) const { return sqlite3_column_count(_stmt); }
+    bool null(int col) const
+    { return sqlite3_column_type(_stmt, col) == SQLITE_NULL; }
+    string text(int col) const;
+    int integer(int col) const { return sqlite3_column_int(_stmt, col); }
+
+  private:
+
+    sqlite3 *_db;
+    sqlite3_stmt *_stmt;
+    bool _cached;
+  };
+
+
+  // Transaction scope.  Changes made while a Transaction is live are
+  // committed by commit(), and rolled back if it goes out of scope
+  // first (e.g. because an exception was thrown).  A Transaction
+  // started while another one is already open just joins it.
+
+  class Transaction {
+  public:
+
+    Transaction(ConnectionPriv *priv);
+    ~Transaction();
+
+    void commit(void);
+
+  private:
+
+    ConnectionPriv *_priv;
+    bool _active;
+  };
+
+
+  // One row of the catalog, as read from the doc_types, field_types
+  // or doc_fields table (with no extra data for doc_fields).
+
+  struct CatalogRow {
+    enum Kind { DOC_TYPE, FIELD_TYPE, DOC_FIELD };
+    CatalogRow(Kind kind, string id, string name, string extra) :
+      kind(kind), id(id), name(name), extra(extra) { }
+    Kind kind;
+    string id, name, extra;
+  };
+
+
+  // Bulk load state.  The loader's transaction is opened when it's
+  // created; the insert statement is prepared afresh for each table.
+
+  struct LoadTable;
+  struct BulkLoaderPriv {
+    BulkLoaderPriv(ConnectionPriv *priv) :
+      trans(priv), table(0), insert(0), rows(0), suspended(false),
+      documents(false), deleted(false), journals(false),
+      catalog(false), committed(false) { }
+    ~BulkLoaderPriv() { delete insert; }
+
+    Transaction trans;
+    const LoadTable *table;
+    Statement *insert;
+    int rows;
+    bool suspended, documents, deleted, journals, catalog, committed;
+  };
+
+
+//----------------------------------------------------------------------
+//
+//  FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+  // Schema management (Schema.cpp).
+
+  int schema_version(ConnectionPriv *priv);
+  int migrate_schema(ConnectionPriv *priv);
+  void check_indexes(ConnectionPriv *priv);
+  void suspend_indexes(ConnectionPriv *priv);
+  void restore_indexes(ConnectionPriv *priv);
+
+  // Catalog loading (CatalogLoad.cpp).
+
+  void read_catalog(ConnectionPriv *priv, vector<CatalogRow> &rows);
+  bool read_catalog_snapshot(string file, int version,
+                             vector<CatalogRow> &rows);
+  void write_catalog_snapshot(string file, int version,
+                              const vector<CatalogRow> &rows);
+
+  // Patterns matched by a quick search string (DocMgr.cpp).
+
+  void quick_patterns(string quick, vector<string> &patterns);
+};
+
+#endif
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,600 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   DocStore.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  In-memory document store for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+static string fold(const string &str);
+static bool like_match(const char *pattern, const char *str);
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: DocSet
+//
+//----------------------------------------------------------------------
+
+void DocSet::resize(int size)
+{
+  _size = size;
+  _bits.resize((size + 63) / 64, 0);
+}
+
+void DocSet::fill(void)
+{
+  _bits.assign(_bits.size(), ~0ULL);
+  if (_size % 64) _bits.back() = (1ULL << (_size % 64)) - 1;
+}
+
+
+// Index of the first member of the set at or after idx, or -1 if
+// there isn't one.
+
+int DocSet::next(int idx) const
+{
+  if (idx < 0) idx = 0;
+  if (idx >= _size) return -1;
+  int word = idx >> 6;
+  unsigned long long bits = _bits[word] & (~0ULL << (idx & 63));
+  while (!bits) {
+    if (++word >= _bits.size()) return -1;
+    bits = _bits[word];
+  }
+  return word * 64 + __builtin_ctzll(bits);
+}
+
+int DocSet::count(void) const
+{
+  int retval = 0;
+  for (int idx = 0; idx < _bits.size(); ++idx)
+    retval += __builtin_popcountll(_bits[idx]);
+  return retval;
+}
+
+// Set operations work a word at a time, in simple loops over the
+// raw arrays that the compiler can vectorise.
+
+DocSet &DocSet::operator&=(const DocSet &other)
+{
+  int n = min(_bits.size(), other._bits.size());
+  unsigned long long *dst = _bits.data();
+  const unsigned long long *src = other._bits.data();
+  for (int idx = 0; idx < n; ++idx) dst[idx] &= src[idx];
+  for (int idx = n; idx < _bits.size(); ++idx) dst[idx] = 0;
+  return *this;
+}
+
+DocSet &DocSet::operator|=(const DocSet &other)
+{
+  int n = min(_bits.size(), other._bits.size());
+  unsigned long long *dst = _bits.data();
+  const unsigned long long *src = other._bits.data();
+  for (int idx = 0; idx < n; ++idx) dst[idx] |= src[idx];
+  return *this;
+}
+
+DocSet &DocSet::subtract(const DocSet &other)
+{
+  int n = min(_bits.size(), other._bits.size());
+  unsigned long long *dst = _bits.data();
+  const unsigned long long *src = other._bits.data();
+  for (int idx = 0; idx < n; ++idx) dst[idx] &= ~src[idx];
+  return *this;
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: Posting
+//
+//----------------------------------------------------------------------
+
+bool Posting::contains(int idx) const
+{
+  const Chunk *c = chunk(idx >> 16);
+  if (!c) return false;
+  unsigned short low = idx & 0xFFFF;
+  if (!c->bits.empty()) return (c->bits[low >> 6] >> (low & 63)) & 1;
+  return binary_search(c->array.begin(), c->array.end(), low);
+}
+
+
+// Documents are mostly added in index order, so additions to array
+// chunks are usually appends.
+
+void Posting::add(int idx)
+{
+  Chunk *c = chunk(idx >> 16, true);
+  unsigned short low = idx & 0xFFFF;
+  if (c->bits.empty()) {
+    vector<unsigned short>::iterator it =
+      lower_bound(c->array.begin(), c->array.end(), low);
+    if (it != c->array.end() && *it == low) return;
+    if (c->count < POSTING_ARRAY_MAX)
+      c->array.insert(it, low);
+    else {
+      c->bits.assign(1024, 0);
+      for (int aidx = 0; aidx < c->array.size(); ++aidx)
+        c->bits[c->array[aidx] >> 6] |= 1ULL << (c->array[aidx] & 63);
+      vector<unsigned short>().swap(c->array);
+      c->bits[low >> 6] |= 1ULL << (low & 63);
+    }
+  } else {
+    unsigned long long bit = 1ULL << (low & 63);
+    if (c->bits[low >> 6] & bit) return;
+    c->bits[low >> 6] |= bit;
+  }
+  ++c->count;
+  ++_count;
+}
+
+void Posting::remove(int idx)
+{
+  Chunk *c = chunk(idx >> 16, false);
+  if (!c) return;
+  unsigned short low = idx & 0xFFFF;
+  if (c->bits.empty()) {
+    vector<unsigned short>::iterator it =
+      lower_bound(c->array.begin(), c->array.end(), low);
+    if (it == c->array.end() || *it != low) return;
+    c->array.erase(it);
+  } else {
+    unsigned long long bit = 1ULL << (low & 63);
+    if (!(c->bits[low >> 6] & bit)) return;
+    c->bits[low >> 6] &= ~bit;
+    if (c->count - 1 <= POSTING_ARRAY_MAX) {
+      for (int word = 0; word < 1024; ++word)
+        for (unsigned long long bits = c->bits[word]; bits; bits &= bits - 1)
+          c->array.push_back(word * 64 + __builtin_ctzll(bits));
+      vector<unsigned long long>().swap(c->bits);
+    }
+  }
+  --_count;
+  if (--c->count == 0) _chunks.erase(_chunks.begin() + (c - &_chunks[0]));
+}
+
+
+// Union of the posting list into a set of documents: bitmap chunks
+// are ORed in a word at a time.
+
+void Posting::add_to(DocSet &set) const
+{
+  for (int cidx = 0; cidx < _chunks.size(); ++cidx) {
+    const Chunk &c = _chunks[cidx];
+    int base = c.key << 16;
+    if (c.bits.empty()) {
+      for (int aidx = 0; aidx < c.array.size(); ++aidx)
+        if (base + c.array[aidx] < set._size) set.add(base + c.array[aidx]);
+    } else {
+      int first = base >> 6;
+      int n = min(1024, static_cast<int>(set._bits.size()) - first);
+      unsigned long long *dst = set._bits.data() + first;
+      const unsigned long long *src = c.bits.data();
+      for (int word = 0; word < n; ++word) dst[word] |= src[word];
+    }
+  }
+}
+
+Posting::Chunk *Posting::chunk(int key, bool create)
+{
+  int cidx = _chunks.size();
+  while (cidx > 0 && _chunks[cidx - 1].key >= key) --cidx;
+  if (cidx < _chunks.size() && _chunks[cidx].key == key)
+    return &_chunks[cidx];
+  if (!create) return 0;
+  Chunk c;
+  c.key = key;
+  c.count = 0;
+  return &*_chunks.insert(_chunks.begin() + cidx, c);
+}
+
+const Posting::Chunk *Posting::chunk(int key) const
+{
+  for (int cidx = _chunks.size() - 1; cidx >= 0; --cidx)
+    if (_chunks[cidx].key == key) return &_chunks[cidx];
+  return 0;
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: DocStore
+//
+//----------------------------------------------------------------------
+
+void DocStore::load(ConnectionPriv *priv)
+{
+  ids.clear();
+  index.assign(MAX_DOC_IDS, -1);
+  ordered = true;
+  present = DocSet();
+  deleted = DocSet();
+  status = Column(true);
+  holding = Column(true);
+  fields.clear();
+  exact_fields.clear();
+
+  Statement exact(priv, "SELECT id FROM field_types WHERE condition='=';");
+  while (exact.step()) exact_fields.push_back(exact.text(0));
+
+  Statement docs(priv, "SELECT id, holding, status FROM documents "
+                 "ORDER BY id;");
+  while (docs.step()) {
+    int idx = add(DocID(docs.integer(0)));
+    holding.set(idx, docs.text(1));
+    status.set(idx, docs.text(2));
+  }
+
+  Statement data(priv, "SELECT doc_id, field_id, data FROM doc_data;");
+  while (data.step()) {
+    int idx = index_of(DocID(data.integer(0)));
+    if (idx >= 0) column(data.text(1)).set(idx, data.text(2));
+  }
+
+  Statement del(priv, "SELECT id FROM deleted_ids;");
+  while (del.step()) {
+    int idx = index_of(DocID(del.integer(0)));
+    if (idx >= 0) deleted.add(idx);
+  }
+}
+
+
+// Documents are added and updated from records that have just been
+// written to the database.  As with DocRecord::update, only the
+// fields present in the record are changed.
+
+void DocStore::put(DocRecord &doc)
+{
+  int idx = index_of(doc.id());
+  if (idx < 0) idx = add(doc.id());
+  holding.set(idx, doc.holding());
+  status.set(idx, doc.status());
+  for (DocFields::const_iterator it = doc.fields().begin();
+       it != doc.fields().end(); ++it)
+    column(it->first.id()).set(idx, it->second);
+}
+
+
+// Purged documents keep their index, which is just dropped from the
+// set of documents present, but their values are cleared so that they
+// don't take up space in posting lists.
+
+void DocStore::remove(DocID id)
+{
+  int idx = index_of(id);
+  if (idx < 0) return;
+  holding.set(idx, "");
+  status.set(idx, "");
+  for (map<string, Column>::iterator it = fields.begin();
+       it != fields.end(); ++it)
+    if (idx < it->second.values.size()) it->second.set(idx, "");
+  present.remove(idx);
+  deleted.remove(idx);
+  index[static_cast<int>(id)] = -1;
+}
+
+void DocStore::set_deleted(DocID id, bool del)
+{
+  int idx = index_of(id);
+  if (idx < 0) return;
+  if (del)
+    deleted.add(idx);
+  else
+    deleted.remove(idx);
+}
+
+int DocStore::add(DocID id)
+{
+  int idx = ids.size();
+  if (idx > 0 && id < ids.back()) ordered = false;
+  ids.push_back(id);
+  index[static_cast<int>(id)] = idx;
+  present.resize(idx + 1);
+  present.add(idx);
+  deleted.resize(idx + 1);
+  return idx;
+}
+
+
+DocStore::Column &DocStore::column(const string &field)
+{
+  map<string, Column>::iterator it = fields.find(field);
+  if (it == fields.end()) {
+    bool indexed = find(exact_fields.begin(), exact_fields.end(), field) !=
+      exact_fields.end();
+    it = fields.insert(make_pair(field, Column(indexed))).first;
+  }
+  return it->second;
+}
+
+
+void DocStore::match_value(const string &field, const string &val,
+                           DocSet &result) const
+{
+  map<string, Column>::const_iterator it = fields.find(field);
+  if (it != fields.end()) it->second.find(val, result);
+}
+
+
+// An empty field ID matches the patterns against all fields.
+
+void DocStore::match_text(const string &field, const vector<string> &patterns,
+                          DocSet &result) const
+{
+  if (field != "") {
+    map<string, Column>::const_iterator it = fields.find(field);
+    if (it != fields.end()) it->second.search(patterns, result);
+  } else
+    for (map<string, Column>::const_iterator it = fields.begin();
+         it != fields.end(); ++it)
+      it->second.search(patterns, result);
+}
+
+
+// Document IDs for a set of documents, in ID order.
+
+void DocStore::collect(const DocSet &set, vector<DocID> &result) const
+{
+  result.clear();
+  for (int idx = set.next(0); idx >= 0; idx = set.next(idx + 1))
+    result.push_back(ids[idx]);
+  if (!ordered) sort(result.begin(), result.end());
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: DocStore::Column
+//
+//----------------------------------------------------------------------
+
+// Empty values are treated as missing, as they are in the database.
+
+void DocStore::Column::set(int idx, const string &val)
+{
+  if (idx >= values.size()) values.resize(idx + 1, -1);
+  int number = -1;
+  if (val != "") {
+    unordered_map<string, int>::const_iterator it = numbers.find(val);
+    if (it != numbers.end())
+      number = it->second;
+    else {
+      number = offsets.size();
+      offsets.push_back(text.size());
+      text += fold(val);
+      text += '\0';
+      numbers[val] = number;
+      if (indexed) postings.resize(number + 1);
+    }
+  }
+  if (number == values[idx]) return;
+  if (indexed) {
+    if (values[idx] >= 0) postings[values[idx]].remove(idx);
+    if (number >= 0) postings[number].add(idx);
+  }
+  values[idx] = number;
+}
+
+
+// Exact, case-sensitive match, as for SIMPLE "=" query terms.
+
+void DocStore::Column::find(const string &val, DocSet &result) const
+{
+  unordered_map<string, int>::const_iterator it = numbers.find(val);
+  if (it == numbers.end()) return;
+  int number = it->second;
+  if (indexed) {
+    postings[number].add_to(result);
+    return;
+  }
+  const int *vals = values.data();
+  for (int idx = 0; idx < values.size(); ++idx)
+    if (vals[idx] == number) result.add(idx);
+}
+
+
+// Case-insensitive substring match against any of a list of patterns,
+// with the same meaning as "data LIKE '%pattern%'" in the database.
+// Plain patterns are found with a single scan of the column's text
+// buffer; patterns containing LIKE wildcards are checked against
+// each distinct value in turn.
+
+void DocStore::Column::search(const vector<string> &patterns,
+                              DocSet &result) const
+{
+  vector<char> hits(offsets.size(), false);
+  bool any = false;
+  for (int pidx = 0; pidx < patterns.size(); ++pidx) {
+    string pattern = fold(patterns[pidx]);
+    if (pattern.find_first_of("%_") != string::npos) {
+      pattern = '%' + pattern + '%';
+      for (int number = 0; number < offsets.size(); ++number)
+        if (!hits[number] &&
+            like_match(pattern.c_str(), text.c_str() + offsets[number]))
+          hits[number] = any = true;
+    } else if (pattern == "") {
+      hits.assign(hits.size(), true);
+      any = true;
+    } else {
+      const char *start = text.c_str(), *end = start + text.size();
+      const char *pos = start;
+      int number = 0;
+      while (pos < end) {
+        const char *found = static_cast<const char *>
+          (memmem(pos, end - pos, pattern.c_str(), pattern.size()));
+        if (!found) break;
+        while (number + 1 < offsets.size() &&
+               start + offsets[number + 1] <= found)
+          ++number;
+        hits[number] = any = true;
+        if (++number >= offsets.size()) break;
+        pos = start + offsets[number];
+      }
+    }
+  }
+  if (!any) return;
+
+  const int *vals = values.data();
+  const char *hit = hits.data();
+  for (int idx = 0; idx < values.size(); ++idx)
+    if (vals[idx] >= 0 && hit[vals[idx]]) result.add(idx);
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: Query
+//
+//----------------------------------------------------------------------
+
+// Evaluation of a query against the connection's memory store, giving
+// the same results as the SQL generated for the query.
+
+void Query::evaluate(const DocStore &store, DocSet &result) const
+{
+  result = DocSet(store.size());
+  if (_tree)
+    evaluate(store, _tree, result);
+  else
+    result.fill();
+  result &= store.present;
+  if (!_db->view_deleted()) result.subtract(store.deleted);
+}
+
+void Query::evaluate(const DocStore &store, Query::QTreeNode *node,
+                     DocSet &result)
+{
+  switch (node->type) {
+  case EMPTY:
+    result.fill();
+    break;
+
+  case QUICK: {
+    vector<string> patterns;
+    quick_patterns(*node->quick, patterns);
+    store.match_text("", patterns, result);
+    break;
+  }
+
+  case STATUS:
+    store.status.find(string(*node->status), result);
+    break;
+
+  case HOLDING:
+    store.holding.find(string(*node->holding), result);
+    break;
+
+  case SIMPLE: {
+    string val = node->clause->second;
+    string field_id = node->clause->first.id();
+    if (node->clause->first.condition() == "=")
+      store.match_value(field_id, val, result);
+    else if (node->clause->first.condition() == "~*") {
+      vector<string> patterns;
+      patterns.push_back(val);
+      patterns.push_back(val.substr(0, 1) + '}' + val.substr(1));
+      store.match_text(field_id, patterns, result);
+    }
+    break;
+  }
+
+  case AND: {
+    DocSet other(result.size());
+    evaluate(store, node->node1, result);
+    evaluate(store, node->node2, other);
+    result &= other;
+    break;
+  }
+
+  case OR: {
+    DocSet other(result.size());
+    evaluate(store, node->node1, result);
+    evaluate(store, node->node2, other);
+    result |= other;
+    break;
+  }
+  }
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// LIKE in the database only folds the case of ASCII characters.
+
+static string fold(const string &str)
+{
+  string retval = str;
+  for (int idx = 0; idx < retval.size(); ++idx)
+    if (retval[idx] >= 'A' && retval[idx] <= 'Z')
+      retval[idx] += 'a' - 'A';
+  return retval;
+}
+
+
+// LIKE pattern matching on case-folded strings: "%" matches any
+// sequence of characters and "_" any single (UTF-8) character.
+
+static bool like_match(const char *pattern, const char *str)
+{
+  while (*pattern) {
+    if (*pattern == '%') {
+      while (*pattern == '%') ++pattern;
+      if (!*pattern) return true;
+      for (; *str; ++str)
+        if (like_match(pattern, str)) return true;
+      return false;
+    }
+    if (!*str) return false;
+    if (*pattern == '_') {
+      ++str;
+      while ((*str & 0xC0) == 0x80) ++str;
+    } else if (*pattern != *str)
+      return false;
+    else
+      ++str;
+    ++pattern;
+  }
+  return !*str;
+}
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
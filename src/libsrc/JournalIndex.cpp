@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   JournalIndex.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  In-memory journal abbreviation index for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+static void split_words(const string &key, vector<string> &words);
+static void key_trigrams(const string &key, vector<int> &trigrams);
+static int edit_distance(const string &a, const string &b, int limit);
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: JournalIndex
+//
+//----------------------------------------------------------------------
+
+// If two titles fold to the same key, the first one in the table is
+// used for folded and approximate matches.
+
+void JournalIndex::load(ConnectionPriv *priv)
+{
+  Statement query(priv, "SELECT full_title, abbrev_title "
+                  "FROM journal_abbrevs ORDER BY full_title;");
+  while (query.step()) {
+    int idx = abbrevs.size();
+    string key = fold(query.text(0));
+    exact[query.text(0)] = idx;
+    abbrevs.push_back(query.text(1));
+    keys.push_back(key);
+    if (folded.find(key) == folded.end()) folded[key] = idx;
+  }
+}
+
+
+// The trigram index is only needed for approximate matches, so it's
+// built the first time there's one to do.
+
+void JournalIndex::index_trigrams(void)
+{
+  vector<int> key_tris;
+  for (unordered_map<string, int>::const_iterator it = folded.begin();
+       it != folded.end(); ++it) {
+    key_trigrams(it->first, key_tris);
+    for (int tri = 0; tri < key_tris.size(); ++tri)
+      trigrams[key_tris[tri]].push_back(it->second);
+  }
+  indexed = true;
+}
+
+
+bool JournalIndex::find(const string &full_name, string &abbrev)
+{
+  unordered_map<string, int>::const_iterator it = exact.find(full_name);
+  if (it == exact.end()) {
+    string key = fold(full_name);
+    it = folded.find(key);
+    if (it == folded.end()) {
+      it = approximations.find(key);
+      if (it == approximations.end()) {
+        if (!indexed) index_trigrams();
+        it = approximations.insert(make_pair(key, approximate(key))).first;
+      }
+    }
+  }
+  if (it->second < 0) return false;
+  abbrev = abbrevs[it->second];
+  return true;
+}
+
+
+// Titles are folded to upper case letters and digits, with each run
+// of anything else turned into a single space and "&" into "AND".
+
+string JournalIndex::fold(const string &title)
+{
+  string retval;
+  retval.reserve(title.size());
+  bool space = false;
+  for (int idx = 0; idx < title.size(); ++idx) {
+    unsigned char ch = title[idx];
+    if (isalnum(ch)) {
+      if (space && retval.size() > 0) retval += ' ';
+      space = false;
+      retval += toupper(ch);
+    } else if (ch == '&') {
+      if (retval.size() > 0) retval += ' ';
+      retval += "AND";
+      space = true;
+    } else
+      space = true;
+  }
+  return retval;
+}
+
+
+// A single edit can only remove four of the distinct trigrams of a
+// title (three, or four for a transposition), so the candidates for
+// an approximate match are the titles that have all but four per edit
+// of the trigrams of the key.  Up to one edit in twelve characters is
+// allowed, and titles must have the same number of words.
+
+int JournalIndex::approximate(const string &key) const
+{
+  int limit = max(1, int(key.size()) / 12);
+  vector<int> key_tris;
+  key_trigrams(key, key_tris);
+  int threshold = int(key_tris.size()) - 4 * limit;
+  if (threshold < 1) return -1;
+
+  vector<int> hits(keys.size(), 0), candidates;
+  for (int tri = 0; tri < key_tris.size(); ++tri) {
+    unordered_map<int, vector<int> >::const_iterator it =
+      trigrams.find(key_tris[tri]);
+    if (it == trigrams.end()) continue;
+    const vector<int> &entries = it->second;
+    for (int idx = 0; idx < entries.size(); ++idx)
+      if (++hits[entries[idx]] == threshold)
+        candidates.push_back(entries[idx]);
+  }
+  sort(candidates.begin(), candidates.end());
+
+  vector<string> key_words;
+  split_words(key, key_words);
+  int best = -1, best_distance = limit + 1;
+  bool ambiguous = false;
+  vector<string> cand_words;
+  for (int idx = 0; idx < candidates.size(); ++idx) {
+    const string &cand = keys[candidates[idx]];
+    if (abs(int(cand.size()) - int(key.size())) > limit) continue;
+    int distance = edit_distance(key, cand, best_distance);
+    if (distance > best_distance) continue;
+    split_words(cand, cand_words);
+    if (cand_words.size() != key_words.size()) continue;
+    bool short_words_ok = true;
+    for (int word = 0; word < key_words.size() && short_words_ok; ++word)
+      if ((key_words[word].size() <= 2 || cand_words[word].size() <= 2) &&
+          key_words[word] != cand_words[word])
+        short_words_ok = false;
+    if (!short_words_ok) continue;
+    if (distance < best_distance) {
+      best = candidates[idx];
+      best_distance = distance;
+      ambiguous = false;
+    } else if (distance == best_distance && best >= 0 &&
+               abbrevs[candidates[idx]] != abbrevs[best])
+      ambiguous = true;
+  }
+  return ambiguous ? -1 : best;
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+static void split_words(const string &key, vector<string> &words)
+{
+  words.clear();
+  string::size_type pos = 0;
+  while (pos < key.size()) {
+    string::size_type end = key.find(' ', pos);
+    if (end == string::npos) end = key.size();
+    words.push_back(key.substr(pos, end - pos));
+    pos = end + 1;
+  }
+}
+
+
+// Distinct trigrams of a folded title, packed into integers.
+
+static void key_trigrams(const string &key, vector<int> &trigrams)
+{
+  trigrams.clear();
+  for (int idx = 0; idx + 2 < key.size(); ++idx)
+    trigrams.push_back((static_cast<unsigned char>(key[idx]) << 16) |
+                       (static_cast<unsigned char>(key[idx + 1]) << 8) |
+                       static_cast<unsigned char>(key[idx + 2]));
+  sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+
+// Edit distance, counting transposed letters as a single edit (the
+// commonest typing mistake), giving up and returning limit + 1 as
+// soon as it's bound to be more than the limit.
+
+static int edit_distance(const string &a, const string &b, int limit)
+{
+  int la = a.size(), lb = b.size();
+  if (abs(la - lb) > limit) return limit + 1;
+  vector<int> before(lb + 1), prev(lb + 1), curr(lb + 1);
+  for (int j = 0; j <= lb; ++j) prev[j] = j;
+  for (int i = 1; i <= la; ++i) {
+    curr[0] = i;
+    int row_min = curr[0];
+    for (int j = 1; j <= lb; ++j) {
+      int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+      curr[j] = min(min(prev[j] + 1, curr[j - 1] + 1), prev[j - 1] + cost);
+      if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+        curr[j] = min(curr[j], before[j - 2] + 1);
+      row_min = min(row_min, curr[j]);
+    }
+    if (row_min > limit) return limit + 1;
+    before.swap(prev);
+    prev.swap(curr);
+  }
+  return min(prev[lb], limit + 1);
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
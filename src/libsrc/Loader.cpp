@@ -0,0 +1,202 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   Loader.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Bulk table loading for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL TYPE DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// Tables that can be bulk loaded, with their number of columns, a
+// bit mask of the columns holding document IDs (which may be
+// zero-padded in older backups) and whether loading the table
+// affects the full-text or secondary indexes.
+
+struct DocMgr::LoadTable {
+  const char *name;
+  int columns;
+  unsigned id_columns;
+  bool indexed;
+};
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL VARIABLE DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+static const LoadTable load_tables[] = {
+  { "deleted_ids",     1, 0x1, false },
+  { "doc_data",        3, 0x1, true },
+  { "doc_fields",      2, 0x0, false },
+  { "doc_types",       3, 0x0, false },
+  { "documents",       4, 0x1, true },
+  { "field_types",     3, 0x0, false },
+  { "journal_abbrevs", 2, 0x0, false }
+};
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: BulkLoader
+//
+//----------------------------------------------------------------------
+
+BulkLoader::BulkLoader(Connection &db) :
+  _db(db), _priv(new BulkLoaderPriv(db.priv()))
+{ }
+
+BulkLoader::~BulkLoader()
+{
+  delete _priv;
+}
+
+
+void BulkLoader::table(string name, bool replace)
+{
+  if (_priv->committed)
+    throw Exception(Exception::SEQUENCE, "Bulk load already committed");
+  const LoadTable *table = 0;
+  int ntables = sizeof(load_tables) / sizeof(LoadTable);
+  for (int idx = 0; idx < ntables; ++idx)
+    if (name == load_tables[idx].name) table = &load_tables[idx];
+  if (!table)
+    throw Exception(Exception::DB_ERROR,
+                    "Can't bulk load table '" + name + "'");
+
+  if (table->indexed && !_priv->suspended) {
+    suspend_indexes(_db.priv());
+    _priv->suspended = true;
+  }
+  if (replace)
+    Statement(_db.priv(), "DELETE FROM " + name + ";").exec();
+
+  string sql = "INSERT OR REPLACE INTO " + name + " VALUES (?";
+  for (int col = 1; col < table->columns; ++col) sql += ", ?";
+  sql += ");";
+  delete _priv->insert;
+  _priv->insert = 0;
+  _priv->insert = new Statement(_db.priv(), sql);
+  _priv->table = table;
+  if (name == "documents") _priv->documents = true;
+  if (name == "deleted_ids") _priv->deleted = true;
+  if (name == "journal_abbrevs") _priv->journals = true;
+  if (name == "doc_types" || name == "field_types" || name == "doc_fields")
+    _priv->catalog = true;
+}
+
+
+void BulkLoader::add(const vector<const char *> &values)
+{
+  const LoadTable *table = _priv->table;
+  if (!table || _priv->committed)
+    throw Exception(Exception::SEQUENCE, "No table to bulk load");
+  if (values.size() != table->columns)
+    throw Exception(Exception::DB_ERROR,
+                    string("Wrong number of values for table ") +
+                    table->name);
+
+  Statement &insert = *_priv->insert;
+  for (int col = 0; col < table->columns; ++col) {
+    if (table->id_columns & (1 << col)) {
+      if (!values[col] || !DocID::valid(string(values[col])))
+        throw Exception(Exception::DB_ERROR,
+                        string("Invalid document ID in table ") +
+                        table->name + ": '" +
+                        (values[col] ? values[col] : "NULL") + "'");
+      insert.bind(col + 1, atoi(values[col]));
+    } else
+      insert.bind(col + 1, values[col]);
+  }
+  insert.exec();
+  ++_priv->rows;
+}
+
+
+// The next document ID is moved past any loaded documents, and the
+// connection's map of deleted documents, memory store (if any) and
+// journal abbreviation index are reloaded.  Loading the catalog tables
+// makes the connection reload its document and field types, and
+// removes any catalog snapshot, which is out of date.
+
+void BulkLoader::commit(void)
+{
+  if (_priv->committed)
+    throw Exception(Exception::SEQUENCE, "Bulk load already committed");
+  delete _priv->insert;
+  _priv->insert = 0;
+  _priv->table = 0;
+
+  ConnectionPriv *priv = _db.priv();
+  if (_priv->suspended) restore_indexes(priv);
+  if (_priv->documents)
+    Statement(priv, "UPDATE doc_id SET next_value = "
+              "(SELECT MAX(id) + 1 FROM documents) "
+              "WHERE next_value <= (SELECT MAX(id) FROM documents);").exec();
+  _priv->trans.commit();
+  _priv->committed = true;
+
+  _db.modified();
+  if (_priv->catalog) {
+    remove((priv->dbfile + CATALOG_SNAPSHOT_SUFFIX).c_str());
+    vector<CatalogRow> catalog;
+    read_catalog(priv, catalog);
+    _db.load_catalog(catalog);
+  }
+  if (_priv->deleted) _db.load_deleted();
+  if (_db._store && (_priv->documents || _priv->deleted ||
+                     _priv->suspended || _priv->catalog)) {
+    delete _db._store;
+    _db._store = 0;
+    DocStore *store = new DocStore();
+    store->load(priv);
+    _db._store = store;
+  }
+  if (_priv->journals) {
+    delete _db._journals;
+    _db._journals = 0;
+  }
+}
+
+
+int BulkLoader::rows(void) const
+{
+  return _priv->rows;
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,199 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   QueryJob.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Background query execution for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: QueryJob
+//
+//----------------------------------------------------------------------
+
+QueryJob::QueryJob(Connection &db, string query) :
+  _db(db), _query(query), _generation(db.write_generation()),
+  _cached(false), _priv(new QueryJobPriv(db.priv()->readers, query))
+{ }
+
+QueryJob::~QueryJob()
+{
+  cancel();
+  delete _priv;
+}
+
+bool QueryJob::done(void) const
+{
+  lock_guard<mutex> guard(_priv->lock);
+  return _priv->done;
+}
+
+bool QueryJob::cancelled(void) const
+{
+  lock_guard<mutex> guard(_priv->lock);
+  return _priv->cancelled;
+}
+
+
+// Cancelling a query that has already finished has no effect: its
+// results are still available.
+
+void QueryJob::cancel(void)
+{
+  lock_guard<mutex> guard(_priv->lock);
+  if (!_priv->done) {
+    _priv->cancelled = true;
+    if (_priv->conn) sqlite3_interrupt(_priv->conn->dbconn);
+  }
+}
+
+void QueryJob::wait(void)
+{
+  unique_lock<mutex> guard(_priv->lock);
+  while (!_priv->done) _priv->finished.wait(guard);
+}
+
+
+// The results of a finished query go into the connection's query
+// cache, so running the same query again in the foreground costs
+// nothing, as long as the database hasn't changed in the meantime.
+
+const vector<DocID> &QueryJob::results(void)
+{
+  wait();
+  if (_priv->cancelled)
+    throw Exception(Exception::QUERY_CANCELLED, "Query cancelled");
+  if (_priv->error != "")
+    throw Exception(Exception::DB_ERROR, _priv->error);
+  if (!_cached) {
+    _db.cache_ids(_query, _generation, _priv->ids);
+    _cached = true;
+  }
+  return _priv->ids;
+}
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: QueryJobPriv
+//
+//----------------------------------------------------------------------
+
+QueryJobPriv::QueryJobPriv(ReaderPool *pool, string sql) :
+  pool(pool), sql(sql), conn(0), done(false), cancelled(false)
+{
+  worker = thread(&QueryJobPriv::run, this);
+}
+
+QueryJobPriv::~QueryJobPriv()
+{
+  if (worker.joinable()) worker.join();
+}
+
+
+// Worker thread body.  A cancelled query fails with an "interrupted"
+// error, which is reported as a cancellation rather than an error.
+// The connection is handed back to the pool under the lock, so that
+// a late cancellation can't interrupt some other job's query.
+
+void QueryJobPriv::run(void)
+{
+  vector<DocID> result;
+  string msg = "";
+  ConnectionPriv *reader = 0;
+  try {
+    reader = pool->acquire();
+    {
+      lock_guard<mutex> guard(lock);
+      if (!cancelled) conn = reader;
+    }
+    if (conn) {
+      Statement stmt(conn, sql);
+      while (stmt.step())
+        result.push_back(DocID(stmt.integer(0)));
+    }
+  } catch (Exception &exc) {
+    msg = exc.msg();
+  }
+
+  lock_guard<mutex> guard(lock);
+  if (reader) pool->release(reader);
+  conn = 0;
+  ids.swap(result);
+  error = msg;
+  done = true;
+  finished.notify_all();
+}
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: ReaderPool
+//
+//----------------------------------------------------------------------
+
+ReaderPool::~ReaderPool()
+{
+  for (int idx = 0; idx < idle.size(); ++idx) delete idle[idx];
+}
+
+ConnectionPriv *ReaderPool::acquire(void)
+{
+  unique_lock<mutex> guard(lock);
+  while (idle.empty() && opened >= size) available.wait(guard);
+  if (!idle.empty()) {
+    ConnectionPriv *retval = idle.back();
+    idle.pop_back();
+    return retval;
+  }
+
+  ConnectionPriv *retval = new ConnectionPriv();
+  int res = sqlite3_open_v2(dbfile.c_str(), &retval->dbconn,
+                            SQLITE_OPEN_READONLY, 0);
+  if (res != SQLITE_OK) {
+    string msg = sqlite3_errmsg(retval->dbconn);
+    delete retval;
+    throw Exception(Exception::DB_ERROR,
+                    "Failed to connect to database: " + msg);
+  }
+  sqlite3_busy_timeout(retval->dbconn, BUSY_TIMEOUT);
+  retval->dbfile = dbfile;
+  ++opened;
+  return retval;
+}
+
+void ReaderPool::release(ConnectionPriv *conn)
+{
+  lock_guard<mutex> guard(lock);
+  idle.push_back(conn);
+  available.notify_one();
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,352 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   Schema.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Schema versioning and migration for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  MACRO DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// SQL expression for the doc_text rowid of a doc_data row: the
+// document ID in the high bits, the two field ID characters below.
+
+#define TEXT_KEY(row)                                                   \
+  row ".doc_id * 65536 + unicode(substr(" row ".field_id, 1, 1)) * 256" \
+  " + unicode(substr(" row ".field_id, 2, 1))"
+
+
+// Triggers keeping doc_text in step with doc_data.
+
+#define TEXT_TRIGGERS                                                   \
+  "CREATE TRIGGER doc_text_insert AFTER INSERT ON doc_data BEGIN"       \
+  "  INSERT INTO doc_text (rowid, data)"                                \
+  "    VALUES (" TEXT_KEY("new") ", new.data);"                         \
+  "END;"                                                                \
+  "CREATE TRIGGER doc_text_delete AFTER DELETE ON doc_data BEGIN"       \
+  "  INSERT INTO doc_text (doc_text, rowid, data)"                      \
+  "    VALUES ('delete', " TEXT_KEY("old") ", old.data);"               \
+  "END;"                                                                \
+  "CREATE TRIGGER doc_text_update AFTER UPDATE ON doc_data BEGIN"       \
+  "  INSERT INTO doc_text (doc_text, rowid, data)"                      \
+  "    VALUES ('delete', " TEXT_KEY("old") ", old.data);"               \
+  "  INSERT INTO doc_text (rowid, data)"                                \
+  "    VALUES (" TEXT_KEY("new") ", new.data);"                         \
+  "END;"
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL TYPE DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// Each migration takes a database at the previous schema version up
+// to the given version.  Migrations are applied in order, each in its
+// own transaction along with the update to the schema_version table.
+
+struct Migration {
+  int version;
+  const char *description;
+  const char *sql;
+};
+
+
+// Secondary indexes maintained by the library, which are (re)created
+// when a connection is opened if they're missing.
+
+struct IndexDef {
+  const char *name;
+  const char *sql;
+};
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION PROTOTYPES
+//
+//----------------------------------------------------------------------
+
+static void exec_script(ConnectionPriv *priv, const char *sql,
+                        string description);
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL VARIABLE DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+static const Migration migrations[] = {
+
+  // Version 1: integer document IDs.  The original schema keyed
+  // documents, doc_data and deleted_ids on zero-padded CHAR(6)
+  // strings; documents.id and deleted_ids.id become rowid aliases.
+
+  { 1, "integer document keys",
+    "CREATE TABLE documents_new ("
+    "  id        INTEGER     PRIMARY KEY,"
+    "  doc_type  CHAR(2)     NOT NULL,"
+    "  holding   VARCHAR(3)  DEFAULT '-',"
+    "  status    CHAR(1)     DEFAULT '-');"
+    "INSERT INTO documents_new "
+    "  SELECT CAST(id AS INTEGER), doc_type, holding, status FROM documents;"
+    "DROP TABLE documents;"
+    "ALTER TABLE documents_new RENAME TO documents;"
+
+    "CREATE TABLE doc_data_new ("
+    "  doc_id    INTEGER  NOT NULL,"
+    "  field_id  CHAR(2)  NOT NULL,"
+    "  data      TEXT,"
+    "  PRIMARY KEY (doc_id, field_id));"
+    "INSERT INTO doc_data_new "
+    "  SELECT CAST(doc_id AS INTEGER), field_id, data FROM doc_data;"
+    "DROP TABLE doc_data;"
+    "ALTER TABLE doc_data_new RENAME TO doc_data;"
+
+    "CREATE TABLE deleted_ids_new ("
+    "  id  INTEGER  PRIMARY KEY);"
+    "INSERT INTO deleted_ids_new "
+    "  SELECT CAST(id AS INTEGER) FROM deleted_ids;"
+    "DROP TABLE deleted_ids;"
+    "ALTER TABLE deleted_ids_new RENAME TO deleted_ids;"
+
+    "CREATE TABLE doc_id_new ("
+    "  next_value  INTEGER  NOT NULL);"
+    "INSERT INTO doc_id_new "
+    "  SELECT CAST(next_value AS INTEGER) FROM doc_id;"
+    "DROP TABLE doc_id;"
+    "ALTER TABLE doc_id_new RENAME TO doc_id;" },
+
+  // Version 2: full-text index for quick searches.  doc_text is a
+  // contentless FTS5 table using the trigram tokenizer, so that any
+  // substring of three or more characters can be looked up in the
+  // index.  Each doc_data row has one doc_text row, whose rowid
+  // encodes the document ID and field ID (see TEXT_KEY); triggers on
+  // doc_data keep the index up to date whatever writes to it.
+
+  { 2, "full-text index",
+    "CREATE VIRTUAL TABLE doc_text USING fts5"
+    "  (data, content='', tokenize='trigram');"
+    "INSERT INTO doc_text (rowid, data) "
+    "  SELECT " TEXT_KEY("doc_data") ", data FROM doc_data;"
+    TEXT_TRIGGERS },
+
+  // Version 3: incremental auto-vacuum, so that the space freed by
+  // purging documents can be handed back to the file system a slice
+  // at a time (see Connection::vacuum_step).  The new setting takes
+  // effect in the VACUUM that follows the migrations.
+
+  { 3, "incremental vacuum",
+    "PRAGMA auto_vacuum = INCREMENTAL;" }
+};
+
+
+static const IndexDef indexes[] = {
+
+  // Field value lookups, as generated for SIMPLE query clauses.  The
+  // index covers doc_id so that substring matches within one field
+  // scan only the index, not the whole doc_data table.
+
+  { "doc_data_field_value",
+    "CREATE INDEX doc_data_field_value ON doc_data (field_id, data, doc_id);" },
+
+  // STATUS and HOLDING query clauses.
+
+  { "documents_status",
+    "CREATE INDEX documents_status ON documents (status);" },
+  { "documents_holding",
+    "CREATE INDEX documents_holding ON documents (holding);" }
+};
+
+
+//----------------------------------------------------------------------
+//
+//  FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+// Databases created before schema versioning was introduced have no
+// schema_version table, and count as version 0.
+
+int DocMgr::schema_version(ConnectionPriv *priv)
+{
+  {
+    Statement query(priv, "SELECT COUNT(*) FROM sqlite_master "
+                    "WHERE type='table' AND name='schema_version';");
+    if (!query.step() || query.integer(0) == 0) return 0;
+  }
+  Statement query(priv, "SELECT version FROM schema_version;");
+  if (!query.step())
+    throw Exception(Exception::DB_ERROR,
+                    "Internal DB error: missing schema version!");
+  return query.integer(0);
+}
+
+
+int DocMgr::migrate_schema(ConnectionPriv *priv)
+{
+  int version = schema_version(priv);
+  if (version > CURRENT_SCHEMA_VERSION) {
+    char buff[64];
+    sprintf(buff, "%d", version);
+    throw Exception(Exception::DB_ERROR,
+                    string("Database schema version ") + buff +
+                    " is newer than this program supports");
+  }
+
+  int start_version = version;
+  int nmigrations = sizeof(migrations) / sizeof(Migration);
+  for (int idx = 0; idx < nmigrations; ++idx) {
+    if (migrations[idx].version <= version) continue;
+
+    Transaction trans(priv);
+    exec_script(priv, migrations[idx].sql,
+                string("Schema migration (") +
+                migrations[idx].description + ")");
+    if (version == 0) {
+      Statement create(priv, "CREATE TABLE schema_version "
+                       "(version INTEGER NOT NULL);");
+      create.exec();
+      Statement init(priv, "INSERT INTO schema_version VALUES (0);");
+      init.exec();
+    }
+    Statement set_version(priv, "UPDATE schema_version SET version=?;");
+    set_version.bind(1, migrations[idx].version);
+    set_version.exec();
+    trans.commit();
+
+    version = migrations[idx].version;
+  }
+
+  // Migrations mostly rebuild tables, leaving the old pages on the
+  // free list, so compact the database once they're all done.
+
+  if (version != start_version) {
+    char *errmsg;
+    int res = sqlite3_exec(priv->dbconn, "VACUUM;", 0, 0, &errmsg);
+    if (res != SQLITE_OK) {
+      string excmsg = string("Command failed: ") + errmsg;
+      sqlite3_free(errmsg);
+      throw Exception(Exception::DB_ERROR, excmsg);
+    }
+  }
+  return version;
+}
+
+
+
+void DocMgr::check_indexes(ConnectionPriv *priv)
+{
+  set<string> present;
+  {
+    Statement query(priv, "SELECT name FROM sqlite_master "
+                    "WHERE type='index';");
+    while (query.step()) present.insert(query.text(0));
+  }
+  vector<const IndexDef *> missing;
+  int nindexes = sizeof(indexes) / sizeof(IndexDef);
+  for (int idx = 0; idx < nindexes; ++idx)
+    if (present.find(indexes[idx].name) == present.end())
+      missing.push_back(&indexes[idx]);
+  if (missing.size() == 0) return;
+
+  // New indexes are analysed straight away so that the query planner
+  // knows how selective they are.
+
+  Transaction trans(priv);
+  for (int idx = 0; idx < missing.size(); ++idx) {
+    Statement create(priv, missing[idx]->sql);
+    create.exec();
+  }
+  Statement analyze(priv, "ANALYZE;");
+  analyze.exec();
+  trans.commit();
+}
+
+
+// The full-text index triggers and the secondary indexes are dropped
+// while documents are being bulk loaded, since it's much quicker to
+// build them from scratch afterwards than to keep them up to date row
+// by row.  Both must be called inside a transaction.  The full-text
+// index is filled in rowid order: FTS5 flushes its pending terms to a
+// new segment whenever a rowid comes in lower than the last one, which
+// in table order happens for most documents.
+
+void DocMgr::suspend_indexes(ConnectionPriv *priv)
+{
+  exec_script(priv,
+              "DROP TRIGGER IF EXISTS doc_text_insert;"
+              "DROP TRIGGER IF EXISTS doc_text_delete;"
+              "DROP TRIGGER IF EXISTS doc_text_update;",
+              "Dropping full-text triggers");
+  int nindexes = sizeof(indexes) / sizeof(IndexDef);
+  for (int idx = 0; idx < nindexes; ++idx)
+    Statement(priv, string("DROP INDEX IF EXISTS ") +
+              indexes[idx].name + ";").exec();
+}
+
+
+void DocMgr::restore_indexes(ConnectionPriv *priv)
+{
+  exec_script(priv,
+              "INSERT INTO doc_text (doc_text) VALUES ('delete-all');"
+              "INSERT INTO doc_text (rowid, data) "
+              "  SELECT " TEXT_KEY("doc_data") ", data FROM doc_data"
+              "  ORDER BY doc_id, field_id;"
+              TEXT_TRIGGERS,
+              "Rebuilding full-text index");
+  check_indexes(priv);
+}
+
+
+//----------------------------------------------------------------------
+//
+//  LOCAL FUNCTION DEFINITIONS
+//
+//----------------------------------------------------------------------
+
+static void exec_script(ConnectionPriv *priv, const char *sql,
+                        string description)
+{
+  char *errmsg;
+  int res = sqlite3_exec(priv->dbconn, sql, 0, 0, &errmsg);
+  if (res != SQLITE_OK) {
+    string excmsg = description + " failed: " + errmsg;
+    sqlite3_free(errmsg);
+    throw Exception(Exception::DB_ERROR, excmsg);
+  }
+}
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -0,0 +1,169 @@
+//----------------------------------------------------------------------
+//
+//  FILE:   Validate.cpp
+//  AUTHOR: Ian Ross
+//  DATE:   18-OCT-2026
+//
+//  Whole-database consistency checks for document manager library.
+//
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//
+//  HEADER FILES
+//
+//----------------------------------------------------------------------
+
+// Standard headers.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+using namespace std;
+
+
+// Local headers.
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+//----------------------------------------------------------------------
+//
+//  MEMBER FUNCTION DEFINITIONS: Connection
+//
+//----------------------------------------------------------------------
+
+// The documents are split into one range of IDs per read-only
+// connection, with about the same number of documents in each, and
+// the ranges are checked in parallel.  Field data for documents that
+// don't exist can't turn up in any range, so is looked for here.
+
+void Connection::validate(vector<Violation> &violations)
+{
+  violations.clear();
+
+  vector<bool> exists(MAX_DOC_IDS, false);
+  vector<int> ids;
+  {
+    Statement query(_priv, "SELECT id FROM documents ORDER BY id;");
+    while (query.step()) {
+      int id = query.integer(0);
+      if (id >= 0 && id < MAX_DOC_IDS) exists[id] = true;
+      ids.push_back(id);
+    }
+  }
+
+  int nthreads = _priv->readers->size;
+  if (nthreads > ids.size()) nthreads = ids.size();
+  vector<thread> workers(nthreads);
+  vector<vector<Violation> > results(nthreads);
+  vector<string> errors(nthreads);
+  for (int idx = 0; idx < nthreads; ++idx) {
+    int first = ids[idx * ids.size() / nthreads];
+    int last = ids[(idx + 1) * ids.size() / nthreads - 1];
+    workers[idx] = thread(&Connection::validate_range, this, first, last,
+                          cref(exists), ref(results[idx]), ref(errors[idx]));
+  }
+
+  Statement orphans(_priv, "SELECT doc_id, COUNT(*) FROM doc_data "
+                    "WHERE doc_id NOT IN (SELECT id FROM documents) "
+                    "GROUP BY doc_id;");
+  while (orphans.step())
+    violations.push_back(Violation(Violation::ORPHANED_DATA,
+                                   orphans.integer(0),
+                                   orphans.text(1) + " field(s)"));
+
+  for (int idx = 0; idx < nthreads; ++idx) workers[idx].join();
+  for (int idx = 0; idx < nthreads; ++idx) {
+    if (errors[idx] != "")
+      throw Exception(Exception::DB_ERROR, errors[idx]);
+    violations.insert(violations.end(),
+                      results[idx].begin(), results[idx].end());
+  }
+  sort(violations.begin(), violations.end());
+}
+
+
+// Worker thread body: check the documents with IDs between first and
+// last, along with their field data, which comes back in document ID
+// order, so each document is checked as soon as its last field has
+// been seen.  Errors are passed back to the calling thread.
+
+void Connection::validate_range(int first, int last,
+                                const vector<bool> &exists,
+                                vector<Violation> &violations,
+                                string &error) const
+{
+  ConnectionPriv *reader = 0;
+  try {
+    reader = _priv->readers->acquire();
+    Statement query(reader, "SELECT d.id, d.doc_type, f.field_id, f.data "
+                    "FROM documents d LEFT JOIN doc_data f "
+                    "ON f.doc_id = d.id "
+                    "WHERE d.id BETWEEN ? AND ? ORDER BY d.id;");
+    query.bind(1, first);
+    query.bind(2, last);
+
+    bool more = query.step();
+    while (more) {
+      int id = query.integer(0);
+      OrdinalMap::const_iterator type =
+        _doc_ordinals.find(query.text(1));
+      if (type == _doc_ordinals.end())
+        violations.push_back(Violation(Violation::UNKNOWN_DOCTYPE, id,
+                                       query.text(1)));
+
+      FieldMask present;
+      do {
+        if (query.null(2)) continue;
+        string field_id = query.text(2);
+        OrdinalMap::const_iterator field =
+          _field_ordinals.find(field_id);
+        if (field == _field_ordinals.end()) {
+          violations.push_back(Violation(Violation::UNKNOWN_FIELD, id,
+                                         field_id));
+          continue;
+        }
+        if (type != _doc_ordinals.end() &&
+            !_doc_info[type->second].allowed.test(field->second))
+          violations.push_back(Violation(Violation::UNEXPECTED_FIELD, id,
+                                         field_id));
+        string data = query.text(3);
+        if (data.size() > 0) present.set(field->second);
+        if (field_id == "XR" && data.size() > 0) {
+          if (!DocID::valid(data) || !exists[atoi(data.c_str())])
+            violations.push_back(Violation(Violation::DANGLING_XREF, id,
+                                           data));
+          else if (_deleted[atoi(data.c_str())])
+            violations.push_back(Violation(Violation::DANGLING_XREF, id,
+                                           data + " (deleted)"));
+        }
+      } while ((more = query.step()) && query.integer(0) == id);
+
+      list<FieldType> missing;
+      if (type != _doc_ordinals.end() &&
+          !mandatory_ok(_doc_types[type->second], present, missing)) {
+        string detail = "";
+        for (list<FieldType>::iterator it = missing.begin();
+             it != missing.end(); ++it)
+          detail += (detail == "" ? "" : " ") + string(*it);
+        violations.push_back(Violation(Violation::MISSING_FIELDS, id,
+                                       detail));
+      }
+    }
+  } catch (Exception &exc) {
+    error = exc.msg();
+  }
+  if (reader) _priv->readers->release(reader);
+}
+
+
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
+//----------------------------------------------------------------------
@@ -33,6 +33,7 @@ using namespace std;
 // Local headers.
 
 #include "DocMgr.hh"
+#include "Catalog.hh"
 
 
 //----------------------------------------------------------------------
@@ -41,8 +42,8 @@ using namespace std;
 //
 //----------------------------------------------------------------------
 
-string convert_doc_type(string docmgr);
-string convert_field_type(string docmgr);
+string convert_doc_type(DocMgr::DocType docmgr);
+string convert_field_type(DocMgr::FieldType docmgr);
 void display_record(ostream &ostr, int number, DocMgr::DocRecord *rec);
 string escape_latex_commands(string s);
 
@@ -86,64 +87,6 @@ private:
   int _number;
 };
 
-struct DocMgrToBibTeX {
-  const char *docmgr;
-  const char *bibtex;
-};
-
-
-//----------------------------------------------------------------------
-//
-//  GLOBAL VARIABLE DEFINITIONS
-//
-//----------------------------------------------------------------------
-
-DocMgrToBibTeX doc_types[] = {
-  { "AT", "Article" },
-  { "BK", "Book" },
-  { "BL", "Booklet" },
-  { "IB", "InBook" },
-  { "IC", "InCollection" },
-  { "IP", "InProceedings" },
-  { "MA", "Manual" },
-  { "MT", "MastersThesis" },
-  { "MS", "Misc" },
-  { "PH", "PhdThesis" },
-  { "PR", "Proceedings" },
-  { "TR", "TechReport" },
-  { "UP", "Unpublished" }
-};
-
-DocMgrToBibTeX field_types[] = {
-  { "AD", "address" },
-  { "BT", "booktitle" },
-  { "CA", "chapter" },
-  { "EN", "edition" },
-  { "ED", "editor" },
-  { "HO", "howpublished" },
-  { "IN", "institution" },
-  { "JN", "journal" },
-  { "MO", "month" },
-  { "NT", "note" },
-  { "NO", "number" },
-  { "OG", "organization" },
-  { "PU", "publisher" },
-  { "SH", "school" },
-  { "TI", "title" },
-  { "TY", "type" },
-  { "UR", "url" },
-  { "YR", "year" },
-  { "SE", "series" },
-  { "VO", "volume" },
-  { "AU", "author" },
-  { "LA", "language" },
-  { "IS", "isbn" },
-  { "KW", "keywords" },
-  { "EP", "eprint" },
-  { "PG", "pages" },
-  { "XR", "crossref" }
-};
-
 
 //----------------------------------------------------------------------
 //
@@ -354,14 +297,17 @@ int main(int argc, char *argv[])
     }
 
     // Connect to database.
-    string db = getenv("DOCMGR_DB") ? getenv("DOCMGR_DB") : "docmgr";
-    string host = getenv("DOCMGR_HOST") ? getenv("DOCMGR_HOST") : "";
-    string user = getenv("DOCMGR_USER") ? getenv("DOCMGR_USER") : "";
-    string password = getenv("DOCMGR_PASS") ? getenv("DOCMGR_PASS") : "";
+    string db;
+    if (getenv("DOCMGR_DB"))
+      db = getenv("DOCMGR_DB");
+    else {
+      string home = getenv("HOME");
+      db = home + "/.docmgr2/docmgr.db";
+    }
     string failure_msg;
     DocMgr::Connection *conn = 0;
     try {
-      conn = new DocMgr::Connection(db, host, user, password);
+      conn = new DocMgr::Connection(db, false, true);
     } catch (DocMgr::Exception &exc) {
       if (exc.type() != DocMgr::Exception::DB_ERROR) throw;
       failure_msg = exc.msg();
@@ -419,22 +365,19 @@ int main(int argc, char *argv[])
 //
 //----------------------------------------------------------------------
 
-string convert_doc_type(string docmgr)
+// BibTeX names come straight from the compile-time catalog, without
+// any lookup: types that aren't in the catalog have no BibTeX name.
+
+string convert_doc_type(DocMgr::DocType docmgr)
 {
-  for (int idx = 0;
-       idx < sizeof(doc_types) / sizeof(DocMgrToBibTeX); ++idx)
-    if (docmgr == doc_types[idx].docmgr)
-      return doc_types[idx].bibtex;
-  return "";
+  int idx = docmgr.catalog();
+  return idx < 0 ? "" : DocMgr::Catalog::doc_types[idx].name;
 }
 
-string convert_field_type(string docmgr)
+string convert_field_type(DocMgr::FieldType docmgr)
 {
-  for (int idx = 0;
-       idx < sizeof(field_types) / sizeof(DocMgrToBibTeX); ++idx)
-    if (docmgr == field_types[idx].docmgr)
-      return field_types[idx].bibtex;
-  return "";
+  int idx = docmgr.catalog();
+  return idx < 0 ? "" : DocMgr::Catalog::field_types[idx].name;
 }
 
 string escape_latex_commands(string s)
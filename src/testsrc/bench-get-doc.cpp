@@ -0,0 +1,56 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <sys/time.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+// Time repeated document retrieval by ID: this is what scrolling the
+// ID list does for every keystroke.
+
+static double now(void)
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1.0E6;
+}
+
+int main(int argc, char *argv[])
+{
+  try {
+    string dbfile = argc > 1 ? argv[1] : "docmgr";
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+
+    Connection *conn = new Connection(dbfile);
+
+    vector<DocID> ids;
+    Query(*conn).run(ids);
+    if (ids.size() == 0) {
+      cout << "No documents in database" << endl;
+      return 1;
+    }
+
+    double start = now();
+    long count = 0;
+    for (int pass = 0; pass < passes; ++pass)
+      for (int idx = 0; idx < ids.size(); ++idx) {
+        DocRecord *doc = conn->get_doc_by_id(ids[idx]);
+        delete doc;
+        ++count;
+      }
+    double elapsed = now() - start;
+
+    cout << "get_doc_by_id: " << count << " documents in "
+         << elapsed << " s (" << count / elapsed << " docs/s)" << endl;
+
+    delete conn;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <sys/time.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+// Time each kind of query node: these are the building blocks of
+// every filter and quick search.
+
+static double now(void)
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1.0E6;
+}
+
+static void time_query(Connection *conn, string label, Query q, int passes)
+{
+  vector<DocID> ids;
+  double start = now();
+  for (int pass = 0; pass < passes; ++pass) {
+    conn->clear_query_cache();
+    q.run(ids);
+  }
+  double elapsed = (now() - start) / passes;
+  cout << label << ": " << ids.size() << " results, "
+       << elapsed * 1000.0 << " ms/query" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  try {
+    string dbfile = argc > 1 ? argv[1] : "docmgr";
+    int passes = argc > 2 ? atoi(argv[2]) : 10;
+    bool view_deleted = false, memory_store = false;
+    for (int arg = 3; arg < argc; ++arg) {
+      if (string(argv[arg]) == "all") view_deleted = true;
+      if (string(argv[arg]) == "memory") memory_store = true;
+    }
+
+    double start = now();
+    Connection *conn = new Connection(dbfile, memory_store);
+    conn->set_view_deleted(view_deleted);
+    cout << "Open: " << (now() - start) * 1000.0 << " ms" << endl;
+
+    Query au(*conn, FieldType(*conn, "AU"), "Cox");
+    Query yr(*conn, FieldType(*conn, "YR"), "2003");
+    time_query(conn, "EMPTY          ", Query(*conn), passes);
+    time_query(conn, "QUICK          ", Query(*conn, "Cox carbon"), passes);
+    time_query(conn, "SIMPLE (=)     ", yr, passes);
+    time_query(conn, "SIMPLE (~*)    ", au, passes);
+    time_query(conn, "SIMPLE (~*, 0) ",
+                     Query(*conn, FieldType(*conn, "TI"), "Zhao"), passes);
+    time_query(conn, "STATUS         ", Query(*conn, Status("R")), passes);
+    time_query(conn, "HOLDING        ", Query(*conn, Holding("EP")), passes);
+    time_query(conn, "AND            ", au && yr, passes);
+    time_query(conn, "OR             ",
+                     yr || Query(*conn, FieldType(*conn, "YR"), "2004"), passes);
+
+
+    // Faceted counts: the number of documents with each status and
+    // holding within a filter.
+
+    vector<Query> facets;
+    vector<string> statuses = Status::valid_statuses();
+    vector<string> holdings = Holding::valid_holdings();
+    for (int idx = 0; idx < statuses.size(); ++idx)
+      facets.push_back(yr && Query(*conn, Status(statuses[idx])));
+    for (int idx = 0; idx < holdings.size(); ++idx)
+      facets.push_back(yr && Query(*conn, Holding(holdings[idx])));
+    vector<int> counts;
+    start = now();
+    for (int pass = 0; pass < passes; ++pass) {
+      conn->clear_query_cache();
+      conn->count_queries(facets, counts);
+    }
+    cout << "FACETS (" << facets.size() << ")     : "
+         << (now() - start) / passes * 1000.0 << " ms/set" << endl;
+
+    delete conn;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+int main(void)
+{
+  try {
+    // Background query tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    // One document for each side of the query, so that it can't come
+    // back empty.
+
+    DocID cox_id, carbon_id;
+    {
+      DocRecord doc(*conn, DocType(*conn, "MS"));
+      doc.set_field(FieldType(*conn, "AU"), "K. Cox");
+      doc.set_field(FieldType(*conn, "TI"), "Smoked kippers");
+      doc.intern();
+      cox_id = doc.id();
+    }
+    {
+      DocRecord doc(*conn, DocType(*conn, "MS"));
+      doc.set_field(FieldType(*conn, "AU"), "A. N. Other");
+      doc.set_field(FieldType(*conn, "TI"), "Carbon-neutral kippers");
+      doc.intern();
+      carbon_id = doc.id();
+    }
+
+    Query q = Query(*conn, FieldType(*conn, "AU"), "Cox") ||
+      Query(*conn, "carbon");
+
+    QueryJob *job = q.run_async();
+    job->wait();
+    assert(job->done());
+    assert(!job->cancelled());
+    vector<DocID> async_ids = job->results();
+    delete job;
+    assert(find(async_ids.begin(), async_ids.end(), cox_id) !=
+           async_ids.end());
+    assert(find(async_ids.begin(), async_ids.end(), carbon_id) !=
+           async_ids.end());
+
+    int hits = conn->cache_hits();
+    vector<DocID> ids;
+    q.run(ids);
+    assert(ids == async_ids);
+    assert(conn->cache_hits() == hits + 1);
+
+    // A cancelled query either finishes before the cancellation takes
+    // effect, or reports that it was cancelled.
+
+    job = Query(*conn).run_async();
+    job->cancel();
+    job->wait();
+    assert(job->done());
+    if (job->cancelled()) {
+      bool thrown = false;
+      try { job->results(); }
+      catch (Exception &exc) {
+        thrown = exc.type() == Exception::QUERY_CANCELLED;
+      }
+      assert(thrown);
+    } else
+      assert(job->results().size() > 0);
+    delete job;
+
+    // Counting several queries at once gives the same results as
+    // counting them one at a time.
+
+    vector<Query> queries;
+    queries.push_back(q);
+    queries.push_back(Query(*conn));
+    queries.push_back(Query(*conn, Status("R")));
+    queries.push_back(Query(*conn, FieldType(*conn, "YR"), "2003"));
+    vector<int> counts;
+    conn->clear_query_cache();
+    conn->count_queries(queries, counts);
+    assert(counts.size() == queries.size());
+    conn->clear_query_cache();
+    for (int idx = 0; idx < queries.size(); ++idx)
+      assert(counts[idx] == queries[idx].count());
+
+    // Deleting a running query cancels it.
+
+    job = Query(*conn, "a").run_async();
+    delete job;
+
+    conn->delete_doc(cox_id);
+    conn->delete_doc(carbon_id);
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <assert.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+static int table_count(const char *dbfile)
+{
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  assert(sqlite3_open(dbfile, &db) == SQLITE_OK);
+  assert(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master;",
+                            -1, &stmt, 0) == SQLITE_OK);
+  assert(sqlite3_step(stmt) == SQLITE_ROW);
+  int retval = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  return retval;
+}
+
+int main(void)
+{
+  try {
+    // Online backup tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+    conn->set_view_deleted(true);
+    remove("docmgr_tst.bak.tmp");
+    conn->backup("docmgr_tst.bak.tmp");
+
+    // Changes made after the backup don't get into it.
+
+    DocRecord *doc = new DocRecord(*conn, DocType(*conn, "MS"));
+    doc->set_field(FieldType(*conn, "TI"), "Kippers after the backup");
+    doc->intern();
+    DocID id = doc->id();
+    delete doc;
+
+    Connection *copy = new Connection("docmgr_tst.bak.tmp");
+    copy->set_view_deleted(true);
+    assert(copy->max_doc_id() < id);
+    assert(copy->count_ids("SELECT id FROM documents") ==
+           conn->count_ids("SELECT id FROM documents") - 1);
+    vector<DocID> deleted, copy_deleted;
+    conn->get_deleted_ids(deleted);
+    copy->get_deleted_ids(copy_deleted);
+    assert(deleted == copy_deleted);
+    vector<DocID> ids;
+    copy->get_ids("SELECT id FROM documents ORDER BY id LIMIT 1", ids);
+    assert(ids.size() == 1);
+    DocID first = ids[0];
+    doc = conn->get_doc_by_id(first);
+    DocRecord *copy_doc = copy->get_doc_by_id(first);
+    assert(doc && copy_doc);
+    assert(doc->field(FieldType(*conn, "TI")) ==
+           copy_doc->field(FieldType(*copy, "TI")));
+    delete doc;
+    delete copy_doc;
+    delete copy;
+
+    conn->delete_doc(id);
+    conn->purge_deleted();
+    delete conn;
+    remove("docmgr_tst.bak.tmp");
+
+    // A backup that can't be written fails cleanly.
+
+    conn = new Connection("docmgr_tst");
+    bool caught = false;
+    try { conn->backup("no-such-dir/docmgr_tst.bak.tmp"); }
+    catch (Exception &exc) { caught = true; }
+    assert(caught);
+    delete conn;
+
+    // Backing up by file name leaves the database as it is, without
+    // schema migrations, and doesn't create a missing one.
+
+    sqlite3 *old;
+    remove("docmgr_old.tmp");
+    assert(sqlite3_open("docmgr_old.tmp", &old) == SQLITE_OK);
+    assert(sqlite3_exec(old, "CREATE TABLE kippers (id INTEGER);"
+                        "INSERT INTO kippers VALUES (42);",
+                        0, 0, 0) == SQLITE_OK);
+    sqlite3_close(old);
+    remove("docmgr_old.bak.tmp");
+    Connection::backup("docmgr_old.tmp", "docmgr_old.bak.tmp");
+    assert(table_count("docmgr_old.tmp") == 1);
+    assert(table_count("docmgr_old.bak.tmp") == 1);
+    remove("docmgr_old.tmp");
+    remove("docmgr_old.bak.tmp");
+
+    caught = false;
+    try { Connection::backup("docmgr_none.tmp", "docmgr_none.bak.tmp"); }
+    catch (Exception &exc) { caught = true; }
+    assert(caught);
+    assert(access("docmgr_none.tmp", F_OK) != 0);
+    remove("docmgr_none.bak.tmp");
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+int main(void)
+{
+  try {
+    // Batch document fetch tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    // Three documents from the test database, out of order, with one
+    // repeated.
+
+    vector<DocID> found;
+    conn->get_ids("SELECT id FROM documents ORDER BY id DESC LIMIT 3",
+                  found);
+    assert(found.size() == 3);
+    vector<DocID> ids;
+    ids.push_back(found[1]);
+    ids.push_back(found[2]);
+    ids.push_back(found[0]);
+    ids.push_back(found[2]);
+    vector<DocRecord *> docs;
+    conn->get_docs_by_ids(ids, docs);
+    assert(docs.size() == ids.size());
+    assert(docs[1] != docs[3]);
+    for (int idx = 0; idx < ids.size(); ++idx) {
+      DocRecord *single = conn->get_doc_by_id(ids[idx]);
+      ostringstream batch_str, single_str;
+      batch_str << *docs[idx];
+      single_str << *single;
+      assert(docs[idx]->id() == ids[idx]);
+      assert(!docs[idx]->modified());
+      assert(batch_str.str() == single_str.str());
+      delete single;
+      delete docs[idx];
+    }
+
+    ids.push_back(DocID(999999));
+    try {
+      conn->get_docs_by_ids(ids, docs);
+      assert(false);
+    } catch (Exception &exc) {
+      if (exc.type() != Exception::DOCID_NOT_FOUND) throw;
+      assert(docs.size() == 0);
+    }
+
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <assert.h>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+// Run a statement on a separate connection to the test database,
+// returning the first column of the first row, if any.
+
+static int sql_int(const char *sql)
+{
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  assert(sqlite3_open("docmgr_tst", &db) == SQLITE_OK);
+  assert(sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK);
+  int retval = 0;
+  int res = sqlite3_step(stmt);
+  assert(res == SQLITE_ROW || res == SQLITE_DONE);
+  if (res == SQLITE_ROW) retval = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  return retval;
+}
+
+static DocRecord *make_doc(Connection *conn, string title)
+{
+  DocRecord *doc = new DocRecord(*conn, DocType(*conn, "AT"));
+  doc->set_field(FieldType(*conn, "AU"), "A. N. Other");
+  doc->set_field(FieldType(*conn, "TI"), title);
+  doc->set_field(FieldType(*conn, "JN"), "Kippers Weekly");
+  doc->set_field(FieldType(*conn, "YR"), "2006");
+  return doc;
+}
+
+int main(void)
+{
+  try {
+    // Bulk intern tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    vector<DocRecord *> docs;
+    for (int idx = 0; idx < 3; ++idx)
+      docs.push_back(make_doc(conn, "Bulk import test"));
+    conn->intern_docs(docs);
+    for (int idx = 0; idx < docs.size(); ++idx) {
+      assert(docs[idx]->interned());
+      if (idx > 0)
+        assert(int(docs[idx]->id()) == int(docs[idx - 1]->id()) + 1);
+      DocRecord *check = conn->get_doc_by_id(docs[idx]->id());
+      assert(check->fields()[FieldType(*conn, "TI")] == "Bulk import test");
+      delete check;
+    }
+    DocID last = docs.back()->id();
+
+    // Documents that are already interned are rejected up front.
+
+    DocRecord *fresh = make_doc(conn, "Should not appear");
+    vector<DocRecord *> bad;
+    bad.push_back(fresh);
+    bad.push_back(docs[0]);
+    try {
+      conn->intern_docs(bad);
+      assert(false);
+    } catch (Exception &exc) {
+      assert(exc.type() == Exception::SEQUENCE);
+    }
+    assert(!fresh->interned());
+    assert(conn->max_doc_id() == last);
+
+    // A failure part-way through the inserts rolls the whole batch
+    // back: a row in the way of the second document's ID makes its
+    // insert fail after the first document has gone in.
+
+    int next_id = sql_int("SELECT next_value FROM doc_id;");
+    char buff[128];
+    sprintf(buff, "INSERT INTO documents VALUES (%d, 'AT', '-', '-');",
+            next_id + 1);
+    sql_int(buff);
+    bad.clear();
+    for (int idx = 0; idx < 3; ++idx)
+      bad.push_back(make_doc(conn, "Should not appear"));
+    try {
+      conn->intern_docs(bad);
+      assert(false);
+    } catch (Exception &exc) {
+      assert(exc.type() == Exception::DB_ERROR);
+    }
+    for (int idx = 0; idx < bad.size(); ++idx) {
+      assert(!bad[idx]->interned());
+      delete bad[idx];
+    }
+    assert(sql_int("SELECT next_value FROM doc_id;") == next_id);
+    sprintf(buff, "SELECT COUNT(*) FROM documents WHERE id = %d;", next_id);
+    assert(sql_int(buff) == 0);
+    sprintf(buff, "SELECT COUNT(*) FROM doc_data WHERE doc_id = %d;",
+            next_id);
+    assert(sql_int(buff) == 0);
+    sprintf(buff, "DELETE FROM documents WHERE id = %d;", next_id + 1);
+    sql_int(buff);
+
+    fresh->intern();
+    assert(int(fresh->id()) == int(last) + 1);
+
+    delete fresh;
+    for (int idx = 0; idx < docs.size(); ++idx) delete docs[idx];
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <cstdio>
+#include <algorithm>
+#include <assert.h>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+static void exec(const char *dbfile, const char *sql)
+{
+  sqlite3 *db;
+  assert(sqlite3_open(dbfile, &db) == SQLITE_OK);
+  assert(sqlite3_exec(db, sql, 0, 0, 0) == SQLITE_OK);
+  sqlite3_close(db);
+}
+
+static bool found(Connection *conn, string quick, DocID id)
+{
+  vector<DocID> ids;
+  Query(*conn, quick).run(ids);
+  return find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+static void add(BulkLoader &loader, const char *a, const char *b,
+                const char *c = 0, const char *d = 0)
+{
+  vector<const char *> values;
+  values.push_back(a);
+  values.push_back(b);
+  if (c) values.push_back(c);
+  if (d) values.push_back(d);
+  loader.add(values);
+}
+
+int main(void)
+{
+  try {
+    // Bulk loader tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+    conn->set_view_deleted(true);
+    DocID id = int(conn->max_doc_id()) + 1;
+    string ids = id;
+
+    // A load that isn't committed leaves nothing behind.
+
+    {
+      BulkLoader loader(*conn);
+      loader.table("journal_abbrevs", false);
+      add(loader, "JOURNAL OF FLUID MECHANICS", "J. Fluid Mech.");
+      assert(loader.rows() == 1);
+    }
+    assert(conn->journal_abbrev("JOURNAL OF FLUID MECHANICS") ==
+           "JOURNAL OF FLUID MECHANICS");
+
+    // Abbreviations, and a document whose full-text index entries
+    // must be there once the load is committed.
+
+    {
+      BulkLoader loader(*conn);
+      loader.table("journal_abbrevs", false);
+      add(loader, "JOURNAL OF FLUID MECHANICS", "J. Fluid Mech.");
+      add(loader, "PHYSICAL REVIEW B", "Phys. Rev. B");
+      loader.table("documents", false);
+      add(loader, ids.c_str(), "AT", "-", "-");
+      loader.table("doc_data", false);
+      add(loader, ids.c_str(), "AU", "P. Ostlund", 0);
+      add(loader, ids.c_str(), "TI", "Bulk-loaded kippers", 0);
+      add(loader, ids.c_str(), "JN", "Kippers Weekly", 0);
+      add(loader, ids.c_str(), "YR", "2026", 0);
+      assert(loader.rows() == 7);
+
+      // Bad table names and document IDs are rejected.
+
+      bool caught = false;
+      try { loader.table("doc_text", false); }
+      catch (Exception &exc) { caught = true; }
+      assert(caught);
+      caught = false;
+      try { add(loader, "kipper", "AU", "X. Li", 0); }
+      catch (Exception &exc) { caught = true; }
+      assert(caught);
+
+      loader.commit();
+    }
+
+    assert(conn->journal_abbrev("Journal of Fluid Mechanics") ==
+           "J. Fluid Mech.");
+    assert(conn->max_doc_id() == id);
+    DocRecord *doc = conn->get_doc_by_id(id);
+    assert(doc);
+    assert(doc->field(FieldType(*conn, "TI")) == "Bulk-loaded kippers");
+    delete doc;
+    assert(found(conn, "kippers ostlund", id));
+
+    // New documents get IDs after the loaded ones.
+
+    doc = new DocRecord(*conn, DocType(*conn, "MS"));
+    doc->set_field(FieldType(*conn, "TI"), "Another kipper");
+    doc->intern();
+    assert(doc->id() > id);
+    DocID new_id = doc->id();
+    delete doc;
+
+    conn->delete_doc(id);
+    conn->delete_doc(new_id);
+    conn->purge_deleted();
+    assert(!found(conn, "kippers ostlund", id));
+    delete conn;
+
+    exec("docmgr_tst", "DELETE FROM journal_abbrevs;");
+
+    // Loading catalog tables reloads the connection's document and
+    // field types (on a copy, so the test database keeps its catalog).
+
+    conn = new Connection("docmgr_tst");
+    remove("docmgr_cat.tmp");
+    conn->backup("docmgr_cat.tmp");
+    delete conn;
+    conn = new Connection("docmgr_cat.tmp", true);
+    int ntypes = conn->doc_types().size();
+    assert(!DocType::valid(*conn, "ZZ"));
+    {
+      BulkLoader loader(*conn);
+      loader.table("doc_types", false);
+      add(loader, "ZZ", "Kipper", "(AND TI)");
+      loader.table("doc_fields", false);
+      add(loader, "ZZ", "TI");
+      add(loader, "ZZ", "AU");
+      loader.commit();
+    }
+    assert(conn->doc_types().size() == ntypes + 1);
+    assert(DocType::valid(*conn, "ZZ"));
+    DocType kipper(*conn, "ZZ");
+    assert(conn->doc_fields(kipper).size() == 2);
+    doc = new DocRecord(*conn, kipper);
+    list<FieldType> missing;
+    assert(!doc->mandatory_fields_ok(missing));
+    doc->set_field(FieldType(*conn, "TI"), "Catalogued kippers");
+    assert(doc->mandatory_fields_ok(missing));
+    doc->intern();
+    assert(found(conn, "catalogued", doc->id()));
+    delete doc;
+    delete conn;
+    remove("docmgr_cat.tmp");
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+#include "Catalog.hh"
+
+using namespace DocMgr;
+
+
+static_assert(Catalog::field_index("AU") == 0, "AU comes first");
+static_assert(Catalog::field_index("ZZ") == -1, "No ZZ field type");
+static_assert(Catalog::field_index("au") == -1, "Codes are upper case");
+static_assert(Catalog::doc_index("UP") == Catalog::NDOC_TYPES - 1,
+              "UP comes last");
+
+int main(void)
+{
+  try {
+    // The compile-time catalog must match the one in the database,
+    // which is set up by the schema script.
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    const vector<FieldType> &fields = conn->field_types();
+    assert(fields.size() == Catalog::NFIELD_TYPES);
+    for (int idx = 0; idx < fields.size(); ++idx) {
+      int cat = fields[idx].catalog();
+      assert(cat >= 0);
+      assert(cat == Catalog::field_index(fields[idx].id()));
+      assert(fields[idx].name() == Catalog::field_types[cat].name);
+      assert(fields[idx].condition() == Catalog::field_types[cat].condition);
+    }
+
+    const vector<DocType> &types = conn->doc_types();
+    assert(types.size() == Catalog::NDOC_TYPES);
+    for (int idx = 0; idx < types.size(); ++idx) {
+      int cat = types[idx].catalog();
+      assert(cat >= 0);
+      assert(cat == Catalog::doc_index(types[idx].id()));
+      assert(types[idx].name() == Catalog::doc_types[cat].name);
+      assert(types[idx].mandatory() == Catalog::doc_types[cat].mandatory);
+    }
+
+    // A connection using a catalog snapshot writes one the first time
+    // round, then reads it back, and must end up with the same types
+    // and fields either way.  A snapshot made for another schema
+    // version is ignored and replaced.
+
+    remove("docmgr_tst-catalog");
+    for (int pass = 0; pass < 3; ++pass) {
+      if (pass == 2) {
+        ofstream bad("docmgr_tst-catalog");
+        bad << "docmgr-catalog 0\nend\n";
+      }
+      Connection *snap = new Connection("docmgr_tst", false, true);
+      ifstream check("docmgr_tst-catalog");
+      string header;
+      assert(getline(check, header));
+      assert(header != "docmgr-catalog 0");
+
+      const vector<FieldType> &snap_fields = snap->field_types();
+      assert(snap_fields.size() == fields.size());
+      for (int idx = 0; idx < fields.size(); ++idx) {
+        assert(snap_fields[idx].id() == fields[idx].id());
+        assert(snap_fields[idx].name() == fields[idx].name());
+        assert(snap_fields[idx].condition() == fields[idx].condition());
+        assert(snap_fields[idx].catalog() == fields[idx].catalog());
+      }
+      const vector<DocType> &snap_types = snap->doc_types();
+      assert(snap_types.size() == types.size());
+      for (int idx = 0; idx < types.size(); ++idx) {
+        assert(snap_types[idx].id() == types[idx].id());
+        assert(snap_types[idx].mandatory() == types[idx].mandatory());
+        const vector<FieldType> &df = conn->doc_fields(types[idx]);
+        const vector<FieldType> &sdf = snap->doc_fields(snap_types[idx]);
+        assert(sdf.size() == df.size());
+        for (int fld = 0; fld < df.size(); ++fld)
+          assert(sdf[fld].id() == df[fld].id());
+      }
+      delete snap;
+    }
+    remove("docmgr_tst-catalog");
+
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
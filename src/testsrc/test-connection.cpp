@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
 #include <assert.h>
 
 using namespace std;
@@ -16,6 +17,8 @@ int main(void)
 
     Connection *conn = new Connection("docmgr_tst");
 
+    assert(conn->schema_version() >= 1);
+
     DocID max_id = conn->max_doc_id();
     cout << string(max_id) << endl;
 
@@ -38,6 +41,45 @@ int main(void)
       if (string(dfs[idx]) == "VO") found = true;
     assert(found);
 
+    // Field types are ordinals that sort like their IDs, and a
+    // document's fields are listed in that order.
+
+    for (int idx = 1; idx < ftypes.size(); ++idx) {
+      assert(ftypes[idx - 1] < ftypes[idx]);
+      assert(ftypes[idx - 1].id() < ftypes[idx].id());
+      assert(FieldType(*conn, ftypes[idx].id()) == ftypes[idx]);
+    }
+    assert(DocType(*conn, "AT").id() == "AT");
+    DocRecord rec(*conn, DocType(*conn, "AT"));
+    rec.set_field(FieldType(*conn, "VO"), "12");
+    assert(rec.field(FieldType(*conn, "VO")) == "12");
+    assert(rec.fields()[FieldType(*conn, "VO")] == "12");
+    assert(rec.fields().find(FieldType(*conn, "ED")) == rec.fields().end());
+    FieldType prev;
+    for (DocFields::const_iterator it = rec.fields().begin();
+         it != rec.fields().end(); ++it) {
+      assert(!prev.valid() || prev < it->first);
+      prev = it->first;
+    }
+
+    // Deleted documents are tracked by the connection and hidden from
+    // queries unless deleted documents are being viewed.
+
+    conn->set_view_deleted(false);
+    vector<DocID> ids;
+    assert(!conn->doc_deleted(max_id));
+    conn->delete_doc(max_id);
+    assert(conn->doc_deleted(max_id));
+    Query(*conn).run(ids);
+    assert(find(ids.begin(), ids.end(), max_id) == ids.end());
+    Connection *conn2 = new Connection("docmgr_tst");
+    assert(conn2->doc_deleted(max_id));
+    delete conn2;
+    conn->undelete_doc(max_id);
+    assert(!conn->doc_deleted(max_id));
+    Query(*conn).run(ids);
+    assert(find(ids.begin(), ids.end(), max_id) != ids.end());
+
     delete conn;
 
     cout << "COMPLETED OK" << endl;
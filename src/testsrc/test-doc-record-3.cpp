@@ -1,9 +1,13 @@
 #include <iostream>
 #include <string>
+#include <cstdio>
+#include <ctime>
 #include <assert.h>
 
 using namespace std;
 
+#include <sqlite3.h>
+
 #include "DocMgr.hh"
 
 using namespace DocMgr;
@@ -12,7 +16,7 @@ using namespace DocMgr;
 int main(void)
 {
   try {
-    // Query tests.
+    // Document update tests.
 
     Connection *conn = new Connection("docmgr_tst");
 
@@ -23,6 +27,62 @@ int main(void)
     doc->update();
     delete doc;
 
+    // Only changes are written, whether made through set_field or
+    // through the field references, and an unchanged record writes
+    // nothing at all.
+
+    doc = conn->get_doc_by_id(DocID(4));
+    assert(doc->field(FieldType(*conn, "AU")) == "Billy Bragg");
+    assert(doc->field(FieldType(*conn, "MO")) == "December");
+    assert(doc->field(FieldType(*conn, "PG")) == "");
+    unsigned long gen = conn->write_generation();
+    doc->update();
+    assert(conn->write_generation() == gen);
+
+    // Saving an unchanged record doesn't wait for another writer.
+
+    sqlite3 *writer;
+    assert(sqlite3_open("docmgr_tst", &writer) == SQLITE_OK);
+    assert(sqlite3_exec(writer, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK);
+    time_t start = time(0);
+    doc->update();
+    assert(time(0) - start < 2);
+    sqlite3_exec(writer, "COMMIT;", 0, 0, 0);
+    sqlite3_close(writer);
+
+    doc->fields()[FieldType(*conn, "PG")] = "12-14";
+    doc->set_status(Status("R"));
+    doc->update();
+    assert(conn->write_generation() != gen);
+    delete doc;
+
+    doc = conn->get_doc_by_id(DocID(4));
+    assert(doc->field(FieldType(*conn, "PG")) == "12-14");
+    assert(doc->status() == Status("R"));
+    delete doc;
+
+    // Saving a record whose document has been purged fails, and
+    // leaves no field data behind.
+
+    doc = new DocRecord(*conn, DocType(*conn, "MS"));
+    doc->set_field(FieldType(*conn, "TI"), "Short-lived kippers");
+    doc->intern();
+    DocID gone = doc->id();
+    conn->delete_doc(gone);
+    conn->purge_deleted();
+    doc->set_field(FieldType(*conn, "TI"), "Resurrected kippers");
+    bool caught = false;
+    try { doc->update(); }
+    catch (Exception &exc) {
+      caught = exc.type() == Exception::DOCID_NOT_FOUND;
+    }
+    assert(caught);
+    delete doc;
+    char buff[80];
+    sprintf(buff, "SELECT doc_id FROM doc_data WHERE doc_id = %d",
+            int(gone));
+    assert(conn->count_ids(buff) == 0);
+
     delete conn;
 
     cout << "COMPLETED OK" << endl;
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <assert.h>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+// The library has no way to edit the abbreviation table, so the test
+// entries go in directly.
+
+static void exec(const char *dbfile, const char *sql)
+{
+  sqlite3 *db;
+  assert(sqlite3_open(dbfile, &db) == SQLITE_OK);
+  assert(sqlite3_exec(db, sql, 0, 0, 0) == SQLITE_OK);
+  sqlite3_close(db);
+}
+
+int main(void)
+{
+  try {
+    // Journal abbreviation tests.
+
+    exec("docmgr_tst",
+         "INSERT INTO journal_abbrevs VALUES "
+         "('PHYSICAL REVIEW B', 'Phys. Rev. B'), "
+         "('PHYSICAL REVIEW LETTERS', 'Phys. Rev. Lett.'), "
+         "('JOURNAL OF FLUID MECHANICS', 'J. Fluid Mech.'), "
+         "('PROCEEDINGS OF THE ROYAL SOCIETY OF LONDON SERIES A-MATHEMATICAL "
+         "PHYSICAL AND ENGINEERING SCIENCES', 'Proc. R. Soc. Lond. A'), "
+         "('QUARTERLY JOURNAL OF THE ROYAL METEOROLOGICAL SOCIETY', "
+         "'Q. J. R. Meteorol. Soc.');");
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    // Exact and folded matches.
+
+    assert(conn->journal_abbrev("PHYSICAL REVIEW B") == "Phys. Rev. B");
+    assert(conn->journal_abbrev("Physical Review Letters") ==
+           "Phys. Rev. Lett.");
+    assert(conn->journal_abbrev("Journal of Fluid Mechanics.") ==
+           "J. Fluid Mech.");
+    assert(conn->journal_abbrev("Proceedings of the Royal Society of London "
+                                "Series A: Mathematical, Physical & "
+                                "Engineering Sciences") ==
+           "Proc. R. Soc. Lond. A");
+
+    // Approximate matches, and titles that mustn't match.
+
+    assert(conn->journal_abbrev("PHYSICAL REVEIW LETTERS") ==
+           "Phys. Rev. Lett.");
+    assert(conn->journal_abbrev("QUARTERLY JOURNAL OF THE ROYAL "
+                                "METEOROLOGICAL SOCEITY") ==
+           "Q. J. R. Meteorol. Soc.");
+    assert(conn->journal_abbrev("PHYSICAL REVIEW D") == "PHYSICAL REVIEW D");
+    assert(conn->journal_abbrev("JOURNAL OF FLUID DYNAMICS") ==
+           "JOURNAL OF FLUID DYNAMICS");
+    assert(conn->journal_abbrev("NATURE") == "NATURE");
+
+    delete conn;
+
+    exec("docmgr_tst", "DELETE FROM journal_abbrevs;");
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
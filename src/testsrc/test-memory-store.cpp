@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+#include "DocMgrPriv.hh"
+
+using namespace DocMgr;
+
+
+// Queries evaluated against the memory store must give the same
+// results as the same queries run in the database.
+
+static void check(Query mem_q, Query db_q)
+{
+  vector<DocID> mem_ids, db_ids;
+  mem_q.run(mem_ids);
+  db_q.run(db_ids);
+  assert(mem_ids == db_ids);
+  assert(mem_q.count() == db_ids.size());
+  if (db_ids.size() > 0) assert(mem_q.contains(db_ids[0]));
+}
+
+static void check_all(Connection &mem, Connection &db)
+{
+  check(Query(mem), Query(db));
+  check(Query(mem, "Cox carbon"), Query(db, "Cox carbon"));
+  check(Query(mem, "ost"), Query(db, "ost"));
+  check(Query(mem, "Kippers"), Query(db, "Kippers"));
+  check(Query(mem, FieldType(mem, "YR"), "1999"),
+        Query(db, FieldType(db, "YR"), "1999"));
+  check(Query(mem, FieldType(mem, "AU"), "cox"),
+        Query(db, FieldType(db, "AU"), "cox"));
+  check(Query(mem, FieldType(mem, "TI"), "o_e"),
+        Query(db, FieldType(db, "TI"), "o_e"));
+  check(Query(mem, Status("R")), Query(db, Status("R")));
+  check(Query(mem, Holding("EP")), Query(db, Holding("EP")));
+  check(Query(mem, FieldType(mem, "AU"), "Cox") &&
+        (Query(mem, FieldType(mem, "YR"), "2003") || Query(mem, Status("R"))),
+        Query(db, FieldType(db, "AU"), "Cox") &&
+        (Query(db, FieldType(db, "YR"), "2003") || Query(db, Status("R"))));
+}
+
+
+// Posting lists give the same sets whether their chunks are held as
+// arrays or as bitmaps.
+
+static void check_postings(void)
+{
+  Posting p;
+  int n = 3 * POSTING_ARRAY_MAX;
+  for (int idx = 0; idx < n; idx += 2) p.add(idx);
+  p.add(70000);
+  p.add(2);
+  assert(p.count() == n / 2 + 1);
+  assert(p.contains(0) && !p.contains(1) && p.contains(70000));
+  for (int idx = 0; idx < n; idx += 4) p.remove(idx);
+  p.remove(1);
+  assert(p.count() == n / 4 + 1);
+  assert(!p.contains(0) && p.contains(2));
+
+  DocSet set(80000);
+  set.add(1);
+  p.add_to(set);
+  assert(set.count() == n / 4 + 2);
+  for (int idx = set.next(0); idx >= 0; idx = set.next(idx + 1))
+    assert(idx == 1 || p.contains(idx));
+
+  p.remove(70000);
+  for (int idx = 2; idx < n; idx += 4) p.remove(idx);
+  assert(p.count() == 0 && !p.contains(2));
+}
+
+
+int main(void)
+{
+  try {
+    check_postings();
+
+    Connection *mem = new Connection("docmgr_tst", true);
+    Connection *db = new Connection("docmgr_tst");
+    assert(mem->memory_store() && !db->memory_store());
+    check_all(*mem, *db);
+
+    // Changes made through the connection are applied to its store.
+
+    DocRecord *doc = new DocRecord(*mem, DocType(*mem, "AT"));
+    doc->set_field(FieldType(*mem, "TI"), "Stored kippers");
+    doc->set_field(FieldType(*mem, "YR"), "1999");
+    doc->intern();
+    check_all(*mem, *db);
+    doc->set_field(FieldType(*mem, "YR"), "2003");
+    doc->set_status(Status("R"));
+    doc->update();
+    check_all(*mem, *db);
+    mem->delete_doc(doc->id());
+    check_all(*mem, *db);
+    mem->set_view_deleted(true);
+    db->set_view_deleted(true);
+    check_all(*mem, *db);
+
+    // Changes made through another connection cause a reload.
+
+    db->undelete_doc(doc->id());
+    check_all(*mem, *db);
+    db->delete_doc(doc->id());
+    db->purge_deleted();
+    check_all(*mem, *db);
+    assert(!Query(*mem, "Stored kippers").contains(doc->id()));
+
+    delete doc;
+    delete db;
+    delete mem;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
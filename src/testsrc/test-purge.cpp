@@ -0,0 +1,147 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <assert.h>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+static int pragma(const char *dbfile, const char *sql)
+{
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  assert(sqlite3_open(dbfile, &db) == SQLITE_OK);
+  assert(sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK);
+  assert(sqlite3_step(stmt) == SQLITE_ROW);
+  int retval = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  return retval;
+}
+
+static bool found(Connection *conn, string quick, DocID id)
+{
+  vector<DocID> ids;
+  Query(*conn, quick).run(ids);
+  return find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+int main(void)
+{
+  try {
+    // Purge and incremental vacuum tests.
+
+    Connection *conn = new Connection("docmgr_tst");
+    conn->set_view_deleted(true);
+    assert(conn->schema_version() >= 3);
+    assert(pragma("docmgr_tst", "PRAGMA auto_vacuum;") == 2);
+
+    // Enough documents to leave plenty of free pages once they've
+    // been purged.
+
+    vector<DocRecord *> docs;
+    string notes(2000, 'x');
+    for (int idx = 0; idx < 500; ++idx) {
+      DocRecord *doc = new DocRecord(*conn, DocType(*conn, "MS"));
+      doc->set_field(FieldType(*conn, "TI"), "Purgeable kippers");
+      doc->set_field(FieldType(*conn, "NT"), notes);
+      docs.push_back(doc);
+    }
+    conn->intern_docs(docs);
+    DocID first = docs.front()->id(), last = docs.back()->id();
+    for (int idx = 0; idx < docs.size(); ++idx) {
+      conn->delete_doc(docs[idx]->id());
+      delete docs[idx];
+    }
+    assert(found(conn, "purgeable", first));
+
+    conn->purge_deleted();
+    vector<DocID> deleted;
+    conn->get_deleted_ids(deleted);
+    assert(deleted.empty());
+    assert(!found(conn, "purgeable", first));
+    assert(!found(conn, "purgeable", last));
+    bool caught = false;
+    try { conn->get_doc_by_id(last); }
+    catch (Exception &exc) {
+      caught = exc.type() == Exception::DOCID_NOT_FOUND;
+    }
+    assert(caught);
+
+    // The vacuum runs in bounded steps until the free list is empty.
+
+    assert(conn->vacuum_pending());
+    int steps = 0;
+    while (conn->vacuum_pending()) {
+      conn->vacuum_step();
+      assert(++steps < 1000);
+    }
+    assert(steps > 1);
+    assert(pragma("docmgr_tst", "PRAGMA freelist_count;") == 0);
+
+    // Quick search still works after the full-text index has been
+    // merged.
+
+    DocRecord *doc = new DocRecord(*conn, DocType(*conn, "MS"));
+    doc->set_field(FieldType(*conn, "TI"), "Unpurged kippers");
+    doc->intern();
+    assert(found(conn, "unpurged", doc->id()));
+    conn->delete_doc(doc->id());
+    conn->purge_deleted();
+    delete doc;
+
+    // A merge left unfinished is picked up by the next connection.
+
+    delete conn;
+    conn = new Connection("docmgr_tst");
+    assert(conn->vacuum_pending());
+
+    // Steps don't wait for, or fail because of, another writer.
+
+    sqlite3 *writer;
+    assert(sqlite3_open("docmgr_tst", &writer) == SQLITE_OK);
+    assert(sqlite3_exec(writer, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK);
+    time_t start = time(0);
+    conn->vacuum_step();
+    assert(time(0) - start < 2);
+    assert(conn->vacuum_pending());
+    sqlite3_exec(writer, "COMMIT;", 0, 0, 0);
+    sqlite3_close(writer);
+    while (conn->vacuum_pending()) conn->vacuum_step();
+
+    // Any other failure is reported, and ends vacuuming through that
+    // connection rather than being retried for ever.  A copy of the
+    // database without its full-text index makes the merge fail.
+
+    remove("docmgr_purge.tmp");
+    conn->backup("docmgr_purge.tmp");
+    assert(sqlite3_open("docmgr_purge.tmp", &writer) == SQLITE_OK);
+    assert(sqlite3_exec(writer, "DROP TABLE doc_text;", 0, 0, 0) == SQLITE_OK);
+    sqlite3_close(writer);
+    Connection *broken = new Connection("docmgr_purge.tmp");
+    assert(broken->vacuum_pending());
+    bool failed = false;
+    try { broken->vacuum_step(); }
+    catch (Exception &exc) { failed = exc.type() == Exception::DB_ERROR; }
+    assert(failed);
+    assert(!broken->vacuum_pending());
+    delete broken;
+    remove("docmgr_purge.tmp");
+
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
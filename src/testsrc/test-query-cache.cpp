@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+int main(void)
+{
+  try {
+    // Query cache tests: repeated queries are served from the cache
+    // until the documents change.
+
+    Connection *conn = new Connection("docmgr_tst");
+    Query q(*conn, FieldType(*conn, "YR"), "1999");
+    vector<DocID> ids1, ids2;
+
+    q.run(ids1);
+    int hits = conn->cache_hits(), misses = conn->cache_misses();
+    q.run(ids2);
+    assert(ids2 == ids1);
+    assert(conn->cache_hits() == hits + 1);
+    assert(conn->cache_misses() == misses);
+
+    DocRecord *doc = new DocRecord(*conn, DocType(*conn, "AT"));
+    doc->set_field(FieldType(*conn, "TI"), "Cached kippers");
+    doc->set_field(FieldType(*conn, "YR"), "1999");
+    unsigned long gen = conn->write_generation();
+    doc->intern();
+    assert(conn->write_generation() != gen);
+    q.run(ids2);
+    assert(conn->cache_misses() == misses + 1);
+    assert(ids2.size() == ids1.size() + 1);
+
+    // Changes made through another connection invalidate the cache
+    // too.
+
+    Connection *conn2 = new Connection("docmgr_tst");
+    conn2->set_view_deleted(true);
+    conn2->delete_doc(doc->id());
+    conn->set_view_deleted(false);
+    q.run(ids2);
+    assert(ids2 == ids1);
+    conn2->undelete_doc(doc->id());
+    q.run(ids2);
+    assert(ids2.size() == ids1.size() + 1);
+
+    conn->delete_doc(doc->id());
+    conn->purge_deleted();
+    q.run(ids2);
+    assert(ids2 == ids1);
+
+    delete doc;
+    delete conn2;
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
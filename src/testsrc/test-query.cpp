@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
 #include <assert.h>
 
 using namespace std;
@@ -57,6 +58,50 @@ int main(void)
       cout << results4[idx] << "  ";
     cout << endl;
 
+    // Mixed conjunctions and disjunctions must give the same results
+    // as combining the results of the individual queries.
+
+    Query q5s(*conn, FieldType(*conn, "YR"), "2004");
+    Query q5 = q1 && (q2s || q5s);
+    string s5(q5);
+    cout << s5 << endl;
+    vector<DocID> results5, results5s, expected5;
+    q5.run(results5);
+    q5s.run(results5s);
+    vector<DocID> years;
+    q2s.run(years);
+    years.insert(years.end(), results5s.begin(), results5s.end());
+    sort(years.begin(), years.end());
+    set_intersection(results1.begin(), results1.end(),
+                     years.begin(), years.end(), back_inserter(expected5));
+    assert(results5 == expected5);
+
+    // Cursors, counts and membership tests agree with full results.
+
+    QueryCursor cursor(q2);
+    DocID id;
+    for (int idx = 0; idx < results2.size(); ++idx) {
+      assert(cursor.next(id));
+      assert(id == results2[idx]);
+    }
+    assert(!cursor.next(id));
+    assert(!cursor.next(id));
+    assert(q5.count() == results5.size());
+    assert(q3.count() == results3.size());
+    assert(q1.contains(results1[0]));
+    for (int idx = 0; idx < results3.size(); ++idx)
+      if (find(results1.begin(), results1.end(), results3[idx]) ==
+          results1.end()) {
+        assert(!q1.contains(results3[idx]));
+        break;
+      }
+    {
+      QueryCursor first(q3);
+      DocRecord *doc = first.next_doc();
+      assert(doc && doc->id() == results3[0]);
+      delete doc;
+    }
+
     delete conn;
 
     cout << "COMPLETED OK" << endl;
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+static bool found(Connection *conn, string quick, DocID id)
+{
+  vector<DocID> ids;
+  Query(*conn, quick).run(ids);
+  return find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+static bool found(Connection *conn, string field, string val, DocID id)
+{
+  vector<DocID> ids;
+  Query(*conn, FieldType(*conn, field), val).run(ids);
+  return find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+int main(void)
+{
+  try {
+    // Quick search tests: the full-text index must follow every
+    // change to the document data.
+
+    Connection *conn = new Connection("docmgr_tst");
+    conn->set_view_deleted(true);
+
+    DocRecord *doc = new DocRecord(*conn, DocType(*conn, "AT"));
+    doc->set_field(FieldType(*conn, "AU"), "P. {\\\"O}stlund and X. Li");
+    doc->set_field(FieldType(*conn, "TI"), "Quasi-geostrophic kippers");
+    doc->set_field(FieldType(*conn, "JN"), "Kippers Weekly");
+    doc->set_field(FieldType(*conn, "YR"), "2006");
+    doc->intern();
+    DocID id = doc->id();
+
+    assert(found(conn, "Ostlund", id));
+    assert(found(conn, "ostLUND", id));
+    assert(found(conn, "Li", id));
+    assert(found(conn, "geostrophic", id));
+    assert(found(conn, "nothing-like-this geostrophic", id));
+    assert(!found(conn, "nothing-like-this", id));
+
+    // Field substring searches use the same index, restricted to
+    // the field being searched.
+
+    assert(found(conn, "AU", "Ostlund", id));
+    assert(found(conn, "AU", "Li", id));
+    assert(found(conn, "TI", "kipper", id));
+    assert(found(conn, "JN", "kipper", id));
+    assert(!found(conn, "AU", "kipper", id));
+    assert(found(conn, "TI", "Quasi%kipp", id));
+    assert(!found(conn, "TI", "Quasi%herring", id));
+
+    doc->set_field(FieldType(*conn, "TI"), "Ageostrophic herring");
+    doc->update();
+    assert(found(conn, "herring", id));
+    assert(found(conn, "geostrophic", id));
+    assert(!found(conn, "Quasi", id));
+
+    // Case is folded for ASCII only, as by LIKE and the memory store,
+    // even though the index folds other letters too.
+
+    doc->set_field(FieldType(*conn, "TI"), "\xc3\x89" "clairs and herring");
+    doc->update();
+    Connection *mem = new Connection("docmgr_tst", true);
+    mem->set_view_deleted(true);
+    assert(found(conn, "\xc3\x89" "CLAIRS", id));
+    assert(found(mem, "\xc3\x89" "CLAIRS", id));
+    assert(!found(conn, "\xc3\xa9" "clairs", id));
+    assert(!found(mem, "\xc3\xa9" "clairs", id));
+    delete mem;
+
+    conn->delete_doc(id);
+    conn->purge_deleted();
+    assert(!found(conn, "herring", id));
+    delete doc;
+
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <assert.h>
+
+using namespace std;
+
+#include "DocMgr.hh"
+
+using namespace DocMgr;
+
+
+static DocRecord *make_doc(Connection *conn, string type, string fields)
+{
+  DocRecord *doc = new DocRecord(*conn, DocType(*conn, type));
+  for (int idx = 0; idx + 1 < fields.size(); idx += 3)
+    doc->set_field(FieldType(*conn, fields.substr(idx, 2)), "Something");
+  return doc;
+}
+
+static string missing(Connection *conn, string type, string fields)
+{
+  DocRecord *doc = make_doc(conn, type, fields);
+  list<FieldType> bad;
+  bool ok = doc->mandatory_fields_ok(bad);
+  delete doc;
+  assert(ok == bad.empty());
+  string retval = "";
+  for (list<FieldType>::iterator it = bad.begin(); it != bad.end(); ++it)
+    retval += (retval == "" ? "" : " ") + string(*it);
+  return retval;
+}
+
+int main(void)
+{
+  try {
+    // Mandatory field tests.  An AND rule reports the first missing
+    // term, an OR rule all of its terms.
+
+    Connection *conn = new Connection("docmgr_tst");
+
+    assert(missing(conn, "AT", "AU JN TI YR") == "");
+    assert(missing(conn, "AT", "AU TI") == "JN");
+    assert(missing(conn, "BK", "ED PU TI YR") == "");
+    assert(missing(conn, "BK", "AU PU TI YR") == "");
+    assert(missing(conn, "BK", "PU TI YR") == "AU ED");
+    assert(missing(conn, "BK", "AU ED TI YR") == "PU");
+    assert(missing(conn, "IB", "AU TI XR") == "CA PG");
+    assert(missing(conn, "BL", "") == "TI");
+    assert(missing(conn, "MS", "") == "");
+
+    // Whole-database validation.
+
+    vector<Violation> violations;
+    conn->validate(violations);
+    assert(violations.empty());
+
+    DocRecord *good = make_doc(conn, "IC", "AU TI YR");
+    good->set_field(FieldType(*conn, "XR"), "000002");
+    good->intern();
+    DocRecord *bad = make_doc(conn, "IC", "AU TI YR");
+    bad->set_field(FieldType(*conn, "XR"), "999998");
+    bad->intern();
+    DocRecord *incomplete = make_doc(conn, "BK", "TI YR");
+    incomplete->intern();
+
+    conn->validate(violations);
+    assert(violations.size() == 2);
+    assert(violations[0].kind == Violation::DANGLING_XREF);
+    assert(violations[0].doc_id == bad->id());
+    assert(violations[0].detail == "999998");
+    assert(violations[1].kind == Violation::MISSING_FIELDS);
+    assert(violations[1].doc_id == incomplete->id());
+    assert(violations[1].detail == "AU ED");
+
+    conn->delete_doc(good->id());
+    conn->delete_doc(bad->id());
+    conn->delete_doc(incomplete->id());
+    conn->purge_deleted();
+    conn->validate(violations);
+    assert(violations.empty());
+    delete good;
+    delete bad;
+    delete incomplete;
+
+    delete conn;
+
+    cout << "COMPLETED OK" << endl;
+  }
+  catch (Exception &exc) {
+    cout << "UNHANDLED DocMgr EXCEPTION: " << exc.msg() << endl;
+  }
+}